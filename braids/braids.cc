@@ -57,6 +57,7 @@ const size_t kNumBlocks = 4;
 const size_t kBlockSize = 24;
 
 MacroOscillator osc;
+DelayLines delay_lines;
 Envelope envelope;
 Adc adc;
 Dac dac;
@@ -149,6 +150,7 @@ void Init() {
 #endif
   dac.Init();
   osc.Init();
+  osc.set_delay_lines(&delay_lines);
   quantizer.Init();
   internal_adc.Init();
   
@@ -108,6 +108,16 @@ void DigitalOscillator::Render(
   
   RenderFn fn = fn_table_[shape_];
   
+  if (!delay_lines_ && (
+          fn == &DigitalOscillator::RenderComb ||
+          fn == &DigitalOscillator::RenderPlucked ||
+          fn == &DigitalOscillator::RenderBowed ||
+          fn == &DigitalOscillator::RenderBlown ||
+          fn == &DigitalOscillator::RenderFluted)) {
+    memset(buffer, 0, size * sizeof(int16_t));
+    return;
+  }
+  
   if (shape_ != previous_shape_) {
     Init();
     previous_shape_ = shape_;
@@ -251,7 +261,7 @@ void DigitalOscillator::RenderComb(
   filtered_pitch = (15 * filtered_pitch + pitch) >> 4;
   state_.ffm.previous_sample = filtered_pitch;
   
-  int16_t* dl = delay_lines_.comb;
+  int16_t* dl = delay_lines_->comb;
   uint32_t delay = ComputeDelay(filtered_pitch);
   if (delay > (kCombDelayLength << 16)) {
     delay = kCombDelayLength << 16;
@@ -1141,7 +1151,7 @@ void DigitalOscillator::RenderPlucked(
     int32_t sample = 0;
     for (size_t i = 0; i < kNumPluckVoices; ++i) {
       PluckState* p = &state_.plk[i];
-      int16_t* dl = delay_lines_.ks + i * 1025;
+      int16_t* dl = delay_lines_->ks + i * 1025;
       // Initialization: Just use a white noise sample and fill the delay
       // line.
       if (p->initialization_ptr) {
@@ -1197,12 +1207,12 @@ void DigitalOscillator::RenderBowed(
     const uint8_t* sync,
     int16_t* buffer,
     size_t size) {
-  int8_t* dl_b = delay_lines_.bowed.bridge;
-  int8_t* dl_n = delay_lines_.bowed.neck;
+  int8_t* dl_b = delay_lines_->bowed.bridge;
+  int8_t* dl_n = delay_lines_->bowed.neck;
   
   if (strike_) {
-    memset(dl_b, 0, sizeof(delay_lines_.bowed.bridge));
-    memset(dl_n, 0, sizeof(delay_lines_.bowed.neck));
+    memset(dl_b, 0, sizeof(delay_lines_->bowed.bridge));
+    memset(dl_n, 0, sizeof(delay_lines_->bowed.neck));
     memset(&state_, 0, sizeof(state_));
     strike_ = false;
   }
@@ -1307,9 +1317,9 @@ void DigitalOscillator::RenderBlown(
   uint16_t delay_ptr = state_.phy.delay_ptr;
   int32_t lp_state = state_.phy.lp_state;
   
-  int16_t* dl = delay_lines_.bore;
+  int16_t* dl = delay_lines_->bore;
   if (strike_) {
-    memset(dl, 0, sizeof(delay_lines_.bore));
+    memset(dl, 0, sizeof(delay_lines_->bore));
     strike_ = false;
   }
 
@@ -1375,13 +1385,13 @@ void DigitalOscillator::RenderFluted(
   int32_t dc_blocking_x0 = state_.phy.filter_state[0];
   int32_t dc_blocking_y0 = state_.phy.filter_state[1];
 
-  int8_t* dl_b = delay_lines_.fluted.bore;
-  int8_t* dl_j = delay_lines_.fluted.jet;
+  int8_t* dl_b = delay_lines_->fluted.bore;
+  int8_t* dl_j = delay_lines_->fluted.jet;
   
   if (strike_) {
     excitation_ptr = 0;
-    memset(dl_b, 0, sizeof(delay_lines_.fluted.bore));
-    memset(dl_j, 0, sizeof(delay_lines_.fluted.jet));
+    memset(dl_b, 0, sizeof(delay_lines_->fluted.bore));
+    memset(dl_j, 0, sizeof(delay_lines_->fluted.jet));
     lp_state = 0;
     strike_ = false;
   }
@@ -1463,12 +1473,7 @@ void DigitalOscillator::RenderFluted(
   state_.phy.filter_state[1] = dc_blocking_y0;
 }
 
-struct WavetableDefinition {
-  uint8_t num_steps;
-  uint8_t wave_index[17];
-};
-
-static const WavetableDefinition wavetable_definitions[] = {
+const WavetableDefinition wavetable_definitions[kNumWavetables] = {
 // 01 male
 { 16 , { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 15 } },
 // 02 female
@@ -1619,7 +1624,7 @@ static const uint8_t wave_line[] = {
 };
 
 
-static const uint8_t mini_wave_line[] = {
+const uint8_t mini_wave_line[] = {
   157, 161, 171, 188, 189, 191, 192, 193, 196, 198, 201, 234, 232,
   229, 226, 224, 1, 2, 3, 4, 5, 8, 12, 32, 36, 42, 47, 252, 254, 141, 139,
   135, 174
@@ -1732,7 +1737,7 @@ void DigitalOscillator::RenderWaveLine(
 
 #define SEMI * 128
 
-static const uint16_t chords[17][3] = {
+const uint16_t paraphonic_chords[kNumParaphonicChords][3] = {
   { 2, 4, 6 },
   { 16, 32, 48 },
   { 2 SEMI, 7 SEMI, 12 SEMI },
@@ -1785,8 +1790,8 @@ void DigitalOscillator::RenderWaveParaphonic(
   }
   
   for (size_t i = 0; i < 3; ++i) {
-    uint16_t detune_1 = chords[chord_integral][i];
-    uint16_t detune_2 = chords[chord_integral + 1][i];
+    uint16_t detune_1 = paraphonic_chords[chord_integral][i];
+    uint16_t detune_2 = paraphonic_chords[chord_integral + 1][i];
     uint16_t detune = detune_1 + ((detune_2 - detune_1) * chord_fractional >> 16);
     phase_increment[i] = ComputePhaseIncrement(pitch_ + detune);
   }
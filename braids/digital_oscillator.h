@@ -216,6 +216,36 @@ struct HatState {
   uint32_t rng_state;
 };
 
+// Delay lines of the comb filter and physical models. They are the bulk of
+// the memory used by an oscillator, and are provided by the caller so that
+// they can be shared, or only allocated to the voices which need them.
+union DelayLines {
+  int16_t comb[kCombDelayLength];
+  int16_t ks[1025 * 4];
+  struct {
+    int8_t bridge[kWGBridgeLength];
+    int8_t neck[kWGNeckLength];
+  } bowed;
+  int16_t bore[kWGBoreLength];
+  struct {
+    int8_t jet[kWGJetLength];
+    int8_t bore[kWGFBoreLength];
+  } fluted;
+};
+
+struct WavetableDefinition {
+  uint8_t num_steps;
+  uint8_t wave_index[17];
+};
+
+// Wave selection tables, shared with the float wavetable renderer.
+static const size_t kNumWavetables = 20;
+static const size_t kNumParaphonicChords = 17;
+
+extern const WavetableDefinition wavetable_definitions[kNumWavetables];
+extern const uint8_t mini_wave_line[];
+extern const uint16_t paraphonic_chords[kNumParaphonicChords][3];
+
 union DigitalOscillatorState {
   ResoSquareState res;
   VowelSynthesizerState vow;
@@ -240,7 +270,7 @@ class DigitalOscillator {
  public:
   typedef void (DigitalOscillator::*RenderFn)(const uint8_t*, int16_t*, size_t);
 
-  DigitalOscillator() { }
+  DigitalOscillator() : delay_lines_(NULL) { }
   ~DigitalOscillator() { }
   
   inline void Init() {
@@ -261,6 +291,19 @@ class DigitalOscillator {
     shape_ = shape;
   }
   
+  // Without delay lines, the comb filter and physical models are silent.
+  // The buffer is cleared whenever it changes hands.
+  inline void set_delay_lines(DelayLines* delay_lines) {
+    if (delay_lines && delay_lines != delay_lines_) {
+      memset(delay_lines, 0, sizeof(DelayLines));
+    }
+    delay_lines_ = delay_lines;
+  }
+  
+  inline bool has_delay_lines() const {
+    return delay_lines_ != NULL;
+  }
+  
   inline void set_pitch(int16_t pitch) {
     // Smooth HF noise when the pitch CV is noisy.
     if (pitch_ > (90 << 7) && pitch > (90 << 7)) {
@@ -359,19 +402,7 @@ class DigitalOscillator {
   Excitation pulse_[4];
   Svf svf_[3];
   
-  union {
-    int16_t comb[kCombDelayLength];
-    int16_t ks[1025 * 4];
-    struct {
-      int8_t bridge[kWGBridgeLength];
-      int8_t neck[kWGNeckLength];
-    } bowed;
-    int16_t bore[kWGBoreLength];
-    struct {
-      int8_t jet[kWGJetLength];
-      int8_t bore[kWGFBoreLength];
-    } fluted;
-  } delay_lines_;
+  DelayLines* delay_lines_;
   
   static RenderFn fn_table_[];
   
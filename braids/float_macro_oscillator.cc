@@ -0,0 +1,331 @@
+// Copyright 2012 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+//
+// Float rendering of the macro-oscillator at an arbitrary host sample rate.
+
+#include "braids/float_macro_oscillator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <xmmintrin.h>
+#endif  // __SSE2__
+
+#include "stmlib/utils/random.h"
+
+#include "braids/resources.h"
+
+namespace braids {
+
+using namespace std;
+using namespace stmlib;
+
+const float kNativeSampleRate = 96000.0f;
+
+// Largest number of waves blended together: the 2x2 waves of the wave map,
+// each of them read at 2 levels.
+const size_t kMaxCrossfadedWaves = 8;
+
+void FloatMacroOscillator::Init(float sample_rate) {
+  oscillator_.Init();
+  shape_ = MACRO_OSC_SHAPE_CSAW;
+  oscillator_.set_shape(shape_);
+  parameter_[0] = parameter_[1] = 0;
+  previous_parameter_ = 0;
+  strike_ = true;
+  sample_rate_ = sample_rate;
+  fill(&phase_[0], &phase_[kNumParaphonicVoices], 0.0f);
+  fill(&crossfade_buffer_[0], &crossfade_buffer_[kWaveStride], 0.0f);
+  has_leftover_ = false;
+  leftover_ = 0.0f;
+  
+  float factor = floorf(kNativeSampleRate / sample_rate + 0.5f);
+  CONSTRAIN(factor, 1.0f, static_cast<float>(kMaxDecimationFactor));
+  decimator_.Init(static_cast<size_t>(factor));
+
+  // The oscillators play flat when run below their native sample rate:
+  // transpose them by the ratio of the two rates.
+  const float internal_sample_rate = sample_rate * factor;
+  pitch_offset_ = static_cast<int16_t>(floorf(
+      128.0f * 12.0f * log2f(kNativeSampleRate / internal_sample_rate) +
+      0.5f));
+  pitch_ = 60 << 7;
+}
+
+void FloatMacroOscillator::Render(
+    const float* sync,
+    float* out,
+    size_t size) {
+  if (has_leftover_ && size) {
+    *out++ = leftover_;
+    if (sync) {
+      ++sync;
+    }
+    --size;
+    has_leftover_ = false;
+  }
+  
+  if (wavetable_cache_) {
+    switch (shape_) {
+      case MACRO_OSC_SHAPE_WAVETABLES:
+        RenderWavetables(sync, out, size);
+        return;
+      case MACRO_OSC_SHAPE_WAVE_MAP:
+        RenderWaveMap(sync, out, size);
+        return;
+      case MACRO_OSC_SHAPE_WAVE_PARAPHONIC:
+        RenderWaveParaphonic(sync, out, size);
+        return;
+      default:
+        break;
+    }
+  }
+  
+  int32_t pitch = pitch_ + pitch_offset_;
+  CONSTRAIN(pitch, 0, 16383);
+  oscillator_.set_pitch(pitch);
+  
+  // The digital oscillators render pairs of samples: an even number of
+  // samples is always rendered at the host rate, so that the internal blocks
+  // are even whatever the decimation factor. An extra sample is kept for the
+  // next call.
+  const size_t factor = decimator_.factor();
+  const size_t max_chunk_size = (kMaxInternalBlockSize / factor) & ~1;
+  while (size) {
+    const size_t chunk_size = min(size, max_chunk_size);
+    const size_t rendered_size = (chunk_size + 1) & ~1;
+    const size_t internal_size = rendered_size * factor;
+    
+    memset(sync_buffer_, 0, internal_size);
+    if (sync) {
+      for (size_t i = 0; i < chunk_size; ++i) {
+        if (sync[i] > 0.0f) {
+          sync_buffer_[i * factor] = 1;
+        }
+      }
+      sync += chunk_size;
+    }
+    oscillator_.Render(sync_buffer_, render_buffer_, internal_size);
+    if (rendered_size == chunk_size) {
+      decimator_.Process(render_buffer_, out, chunk_size);
+    } else {
+      float decimated[kMaxInternalBlockSize];
+      decimator_.Process(render_buffer_, decimated, rendered_size);
+      copy(&decimated[0], &decimated[chunk_size], out);
+      leftover_ = decimated[chunk_size];
+      has_leftover_ = true;
+    }
+    
+    out += chunk_size;
+    size -= chunk_size;
+  }
+}
+
+float FloatMacroOscillator::Frequency(int32_t pitch) const {
+  CONSTRAIN(pitch, 0, 16383);
+  const float semitones = static_cast<float>(pitch - (69 << 7)) / 128.0f;
+  return 440.0f * powf(2.0f, semitones / 12.0f) / sample_rate_;
+}
+
+void FloatMacroOscillator::CrossfadeWaves(
+    const uint8_t* wave_index,
+    const float* gain,
+    size_t num_waves,
+    float frequency) {
+  const float level = WavetableCache::Level(frequency);
+  const size_t level_integral = static_cast<size_t>(level);
+  const float level_fractional = level - static_cast<float>(level_integral);
+  
+  const float* waves[kMaxCrossfadedWaves];
+  float gains[kMaxCrossfadedWaves];
+  size_t n = 0;
+  for (size_t i = 0; i < num_waves; ++i) {
+    waves[n] = wavetable_cache_->wave(wave_index[i], level_integral);
+    gains[n++] = gain[i] * (1.0f - level_fractional);
+    waves[n] = wavetable_cache_->wave(wave_index[i], level_integral + 1);
+    gains[n++] = gain[i] * level_fractional;
+  }
+  
+  float* destination = crossfade_buffer_;
+#ifdef __SSE2__
+  __m128 g[kMaxCrossfadedWaves];
+  for (size_t j = 0; j < n; ++j) {
+    g[j] = _mm_set1_ps(gains[j]);
+  }
+  for (size_t i = 0; i < kWaveStride; i += 4) {
+    __m128 sum = _mm_mul_ps(_mm_loadu_ps(waves[0] + i), g[0]);
+    for (size_t j = 1; j < n; ++j) {
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(waves[j] + i), g[j]));
+    }
+    _mm_storeu_ps(destination + i, sum);
+  }
+#else
+  for (size_t i = 0; i < kWaveStride; ++i) {
+    float sum = waves[0][i] * gains[0];
+    for (size_t j = 1; j < n; ++j) {
+      sum += waves[j][i] * gains[j];
+    }
+    destination[i] = sum;
+  }
+#endif  // __SSE2__
+}
+
+void FloatMacroOscillator::PlayWave(
+    float frequency,
+    float gain,
+    float* phase,
+    const float* sync,
+    float* out,
+    size_t size) {
+  const float* wave = crossfade_buffer_;
+  float p = *phase;
+  for (size_t i = 0; i < size; ++i) {
+    p += frequency;
+    if (p >= 1.0f) {
+      p -= static_cast<float>(static_cast<int32_t>(p));
+    }
+    if (sync && sync[i] > 0.0f) {
+      p = 0.0f;
+    }
+    const float position = p * static_cast<float>(kWaveSize);
+    const size_t integral = static_cast<size_t>(position);
+    const float fractional = position - static_cast<float>(integral);
+    const float a = wave[integral];
+    const float b = wave[integral + 1];
+    out[i] += gain * (a + (b - a) * fractional);
+  }
+  *phase = p;
+}
+
+void FloatMacroOscillator::RenderWavetables(
+    const float* sync,
+    float* out,
+    size_t size) {
+  // Same hysteresis as DigitalOscillator::RenderWavetables.
+  if ((parameter_[1] > previous_parameter_ + 64) ||
+      (parameter_[1] < previous_parameter_ - 64)) {
+    previous_parameter_ = parameter_[1];
+  }
+  uint32_t wavetable_index = static_cast<uint32_t>(previous_parameter_) * 20;
+  wavetable_index >>= 15;
+  const WavetableDefinition& wt = wavetable_definitions[wavetable_index];
+  
+  uint32_t wave_pointer = (parameter_[0] << 1) * wt.num_steps;
+  uint8_t wave_index[2];
+  wave_index[0] = wt.wave_index[wave_pointer >> 16];
+  wave_index[1] = wt.wave_index[(wave_pointer >> 16) + 1];
+  
+  float gain[2];
+  gain[1] = static_cast<float>(wave_pointer & 0xffff) / 65536.0f;
+  gain[0] = 1.0f - gain[1];
+  
+  const float frequency = Frequency(pitch_);
+  CrossfadeWaves(wave_index, gain, 2, frequency);
+  fill(&out[0], &out[size], 0.0f);
+  PlayWave(frequency, 1.0f, &phase_[0], sync, out, size);
+}
+
+void FloatMacroOscillator::RenderWaveMap(
+    const float* sync,
+    float* out,
+    size_t size) {
+  // The grid is 16x16; so there are 15 interpolation squares.
+  uint16_t p[2];
+  float xfade[2];
+  uint16_t wave_coordinate[2];
+  for (size_t i = 0; i < 2; ++i) {
+    p[i] = parameter_[i] * 15 >> 4;
+    xfade[i] = static_cast<float>(static_cast<uint16_t>(p[i] << 5)) / 65536.0f;
+    wave_coordinate[i] = p[i] >> 11;
+  }
+  
+  uint8_t wave_index[4];
+  float gain[4];
+  for (size_t i = 0; i < 2; ++i) {
+    for (size_t j = 0; j < 2; ++j) {
+      uint16_t cell = (wave_coordinate[0] + i) * 16 + (wave_coordinate[1] + j);
+      wave_index[i * 2 + j] = wt_map[cell];
+      gain[i * 2 + j] = (i ? xfade[0] : 1.0f - xfade[0]) * \
+          (j ? xfade[1] : 1.0f - xfade[1]);
+    }
+  }
+  
+  const float frequency = Frequency(pitch_);
+  CrossfadeWaves(wave_index, gain, 4, frequency);
+  fill(&out[0], &out[size], 0.0f);
+  PlayWave(frequency, 1.0f, &phase_[0], sync, out, size);
+}
+
+void FloatMacroOscillator::RenderWaveParaphonic(
+    const float* sync,
+    float* out,
+    size_t size) {
+  if (strike_) {
+    for (size_t i = 0; i < kNumParaphonicVoices; ++i) {
+      phase_[i] = Random::GetFloat();
+    }
+    strike_ = false;
+  }
+  
+  uint16_t chord_integral = parameter_[1] >> 11;
+  uint16_t chord_fractional = parameter_[1] << 5;
+  if (chord_fractional < 30720) {
+    chord_fractional = 0;
+  } else if (chord_fractional >= 34816) {
+    chord_fractional = 65535;
+  } else {
+    chord_fractional = (chord_fractional - 30720) * 16;
+  }
+  
+  uint8_t wave_index[2];
+  wave_index[0] = mini_wave_line[parameter_[0] >> 10];
+  wave_index[1] = mini_wave_line[(parameter_[0] >> 10) + 1];
+  float gain[2];
+  gain[1] = static_cast<float>(static_cast<uint16_t>(parameter_[0] << 6)) / \
+      65536.0f;
+  gain[0] = 1.0f - gain[1];
+  
+  // Like the fixed-point version, the paraphonic voices ignore sync. Each of
+  // them has its own band-limited copy of the wave.
+  fill(&out[0], &out[size], 0.0f);
+  for (size_t i = 0; i < kNumParaphonicVoices; ++i) {
+    int32_t detune = 0;
+    if (i) {
+      uint16_t detune_1 = paraphonic_chords[chord_integral][i - 1];
+      uint16_t detune_2 = paraphonic_chords[chord_integral + 1][i - 1];
+      detune = static_cast<uint16_t>(
+          detune_1 + ((detune_2 - detune_1) * chord_fractional >> 16));
+    }
+    const float frequency = Frequency(pitch_ + detune);
+    CrossfadeWaves(wave_index, gain, 2, frequency);
+    PlayWave(frequency, 0.25f, &phase_[i], NULL, out, size);
+  }
+}
+
+}  // namespace braids
@@ -0,0 +1,155 @@
+// Copyright 2012 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+//
+// Float rendering of the macro-oscillator at an arbitrary host sample rate.
+//
+// The oscillators are tuned for 96kHz. They are run at the multiple of the
+// host sample rate closest to 96kHz, their pitch being corrected for the
+// difference, and their output is decimated down to the host rate.
+//
+// When given a wavetable cache, the smooth wavetable shapes bypass this and
+// are rendered directly at the host rate from band-limited waves.
+
+#ifndef BRAIDS_FLOAT_MACRO_OSCILLATOR_H_
+#define BRAIDS_FLOAT_MACRO_OSCILLATOR_H_
+
+#include "stmlib/stmlib.h"
+
+#include "braids/macro_oscillator.h"
+#include "braids/polyphase_decimator.h"
+#include "braids/wavetable_cache.h"
+
+namespace braids {
+
+// Size of the blocks rendered by MacroOscillator, limited by its internal
+// buffers.
+const size_t kMaxInternalBlockSize = 24;
+
+const size_t kNumParaphonicVoices = 4;
+
+class FloatMacroOscillator {
+ public:
+  FloatMacroOscillator() : wavetable_cache_(NULL) { }
+  ~FloatMacroOscillator() { }
+  
+  void Init(float sample_rate);
+  
+  inline void set_shape(MacroOscillatorShape shape) {
+    if (shape != shape_) {
+      strike_ = true;
+    }
+    shape_ = shape;
+    oscillator_.set_shape(shape);
+  }
+
+  // Same units as MacroOscillator: 128 steps per semitone, 60 << 7 is C4.
+  inline void set_pitch(int16_t pitch) {
+    pitch_ = pitch;
+  }
+  
+  inline void set_parameters(int16_t parameter_1, int16_t parameter_2) {
+    parameter_[0] = parameter_1;
+    parameter_[1] = parameter_2;
+    oscillator_.set_parameters(parameter_1, parameter_2);
+  }
+  
+  inline void Strike() {
+    strike_ = true;
+    oscillator_.Strike();
+  }
+  
+  inline void set_delay_lines(DelayLines* delay_lines) {
+    oscillator_.set_delay_lines(delay_lines);
+  }
+  
+  // The cache is not owned, and can be shared by several oscillators.
+  inline void set_wavetable_cache(const WavetableCache* wavetable_cache) {
+    wavetable_cache_ = wavetable_cache;
+  }
+  
+  inline size_t decimation_factor() const {
+    return decimator_.factor();
+  }
+  
+  // Renders size samples at the host rate, in the [-1, 1] range. A positive
+  // value in the sync buffer hard-syncs the oscillator at this sample. sync
+  // can be NULL.
+  void Render(const float* sync, float* out, size_t size);
+  
+ private:
+  void RenderWavetables(const float* sync, float* out, size_t size);
+  void RenderWaveMap(const float* sync, float* out, size_t size);
+  void RenderWaveParaphonic(const float* sync, float* out, size_t size);
+  
+  float Frequency(int32_t pitch) const;
+  
+  // Fills crossfade_buffer_ with the weighted sum of num_waves waves, each of
+  // them read at the two levels surrounding the one needed at frequency.
+  void CrossfadeWaves(
+      const uint8_t* wave_index,
+      const float* gain,
+      size_t num_waves,
+      float frequency);
+  
+  // Adds the content of crossfade_buffer_, read at frequency, to out.
+  void PlayWave(
+      float frequency,
+      float gain,
+      float* phase,
+      const float* sync,
+      float* out,
+      size_t size);
+  
+  MacroOscillator oscillator_;
+  PolyphaseDecimator decimator_;
+  const WavetableCache* wavetable_cache_;
+  
+  MacroOscillatorShape shape_;
+  int16_t pitch_;
+  int16_t pitch_offset_;
+  int16_t parameter_[2];
+  int16_t previous_parameter_;
+  bool strike_;
+  
+  float sample_rate_;
+  
+  // Sample rendered ahead by the last call, when it asked for an odd number
+  // of samples. A sync pulse on this sample is ignored.
+  float leftover_;
+  bool has_leftover_;
+  float phase_[kNumParaphonicVoices];
+  float crossfade_buffer_[kWaveStride];
+  
+  uint8_t sync_buffer_[kMaxInternalBlockSize];
+  int16_t render_buffer_[kMaxInternalBlockSize];
+  
+  DISALLOW_COPY_AND_ASSIGN(FloatMacroOscillator);
+};
+
+}  // namespace braids
+
+#endif // BRAIDS_FLOAT_MACRO_OSCILLATOR_H_
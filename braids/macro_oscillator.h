@@ -81,6 +81,16 @@ class MacroOscillator {
     digital_oscillator_.Strike();
   }
   
+  inline void set_delay_lines(DelayLines* delay_lines) {
+    digital_oscillator_.set_delay_lines(delay_lines);
+  }
+  
+  // Shapes which are silent unless delay lines are provided.
+  static inline bool uses_delay_lines(MacroOscillatorShape shape) {
+    return shape == MACRO_OSC_SHAPE_SAW_COMB ||
+        (shape >= MACRO_OSC_SHAPE_PLUCKED && shape <= MACRO_OSC_SHAPE_FLUTED);
+  }
+  
   void Render(const uint8_t* sync_buffer, int16_t* buffer, size_t size);
   
  private:
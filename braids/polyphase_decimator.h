@@ -0,0 +1,118 @@
+// Copyright 2012 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+//
+// Polyphase FIR decimator, bringing a 16-bit signal rendered at a multiple of
+// the host sample rate down to float samples at the host rate.
+
+#ifndef BRAIDS_POLYPHASE_DECIMATOR_H_
+#define BRAIDS_POLYPHASE_DECIMATOR_H_
+
+#include "stmlib/stmlib.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace braids {
+
+const size_t kMaxDecimationFactor = 4;
+const size_t kDecimatorTapsPerPhase = 32;
+const size_t kMaxDecimatorTaps = kMaxDecimationFactor * kDecimatorTapsPerPhase;
+
+class PolyphaseDecimator {
+ public:
+  PolyphaseDecimator() { }
+  ~PolyphaseDecimator() { }
+  
+  // Designs a Blackman-windowed sinc low-pass with kDecimatorTapsPerPhase
+  // taps per output phase, cutting off slightly below the output Nyquist
+  // frequency. The int16_t to float scaling is folded into the kernel.
+  void Init(size_t factor) {
+    factor_ = std::max(std::min(factor, kMaxDecimationFactor), size_t(1));
+    num_taps_ = factor_ == 1 ? 1 : factor_ * kDecimatorTapsPerPhase;
+    
+    const float kPi = 3.14159265358979323846f;
+    const float cutoff = 0.42f / static_cast<float>(factor_);
+    const float center = 0.5f * static_cast<float>(num_taps_ - 1);
+    float sum = 0.0f;
+    for (size_t i = 0; i < num_taps_; ++i) {
+      const float t = static_cast<float>(i) - center;
+      const float x = 2.0f * kPi * cutoff * t;
+      const float sinc = t == 0.0f ? 1.0f : sinf(x) / x;
+      const float w = num_taps_ == 1 ? 1.0f : static_cast<float>(i) / \
+          static_cast<float>(num_taps_ - 1);
+      const float window = 0.42f - 0.5f * cosf(2.0f * kPi * w) + \
+          0.08f * cosf(4.0f * kPi * w);
+      kernel_[i] = sinc * window;
+      sum += kernel_[i];
+    }
+    const float scale = 1.0f / (32768.0f * sum);
+    for (size_t i = 0; i < num_taps_; ++i) {
+      kernel_[i] *= scale;
+    }
+    Reset();
+  }
+  
+  void Reset() {
+    std::fill(&history_[0], &history_[2 * kMaxDecimatorTaps], 0.0f);
+    head_ = 0;
+  }
+  
+  inline size_t factor() const { return factor_; }
+  
+  // Consumes size * factor() input samples and writes size output samples.
+  // The filter is only evaluated at the output rate.
+  void Process(const int16_t* in, float* out, size_t size) {
+    const size_t n = num_taps_;
+    while (size--) {
+      for (size_t i = 0; i < factor_; ++i) {
+        head_ = head_ == 0 ? n - 1 : head_ - 1;
+        history_[head_] = history_[head_ + n] = static_cast<float>(*in++);
+      }
+      // history_[head_ + k] holds the input sample delayed by k.
+      const float* x = &history_[head_];
+      float s = 0.0f;
+      for (size_t k = 0; k < n; ++k) {
+        s += kernel_[k] * x[k];
+      }
+      *out++ = s;
+    }
+  }
+  
+ private:
+  size_t factor_;
+  size_t num_taps_;
+  size_t head_;
+  
+  float kernel_[kMaxDecimatorTaps];
+  float history_[2 * kMaxDecimatorTaps];
+  
+  DISALLOW_COPY_AND_ASSIGN(PolyphaseDecimator);
+};
+
+}  // namespace braids
+
+#endif // BRAIDS_POLYPHASE_DECIMATOR_H_
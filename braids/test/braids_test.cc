@@ -18,8 +18,10 @@
 #include <cstring>
 #include <cstdlib>
 
+#include "braids/float_macro_oscillator.h"
 #include "braids/macro_oscillator.h"
 #include "braids/quantizer.h"
+#include "braids/voice_pool.h"
 #include "stmlib/test/wav_writer.h"
 #include "stmlib/utils/dsp.h"
 
@@ -34,7 +36,9 @@ void TestAudioRendering() {
   WavWriter wav_writer(1, kSampleRate, 5);
   wav_writer.Open("oscillator.wav");
 
+  static DelayLines delay_lines;
   osc.Init();
+  osc.set_delay_lines(&delay_lines);
   osc.set_shape(MACRO_OSC_SHAPE_VOWEL_FOF);
 
   for (uint32_t i = 0; i < kSampleRate * 5 / kAudioBlockSize; ++i) {
@@ -57,6 +61,129 @@ void TestAudioRendering() {
   }
 }
 
+void TestFloatRendering() {
+  const uint32_t kHostSampleRate = 48000;
+  FloatMacroOscillator osc;
+  WavWriter wav_writer(1, kHostSampleRate, 5);
+  wav_writer.Open("oscillator_float.wav");
+
+  osc.Init(kHostSampleRate);
+  osc.set_shape(MACRO_OSC_SHAPE_CSAW);
+
+  for (uint32_t i = 0; i < kHostSampleRate * 5 / kAudioBlockSize; ++i) {
+    float buffer[kAudioBlockSize];
+    uint16_t tri = (i * 3);
+    tri = tri > 32767 ? 65535 - tri : tri;
+    osc.set_parameters(tri, 0);
+    osc.set_pitch((48 << 7) + (i >> 2));
+    osc.Render(NULL, buffer, kAudioBlockSize);
+    wav_writer.Write(buffer, kAudioBlockSize, 32767.0f);
+  }
+  
+  // Without decimation, with blocks of odd sizes: the digital oscillators
+  // must still be given even blocks.
+  static DelayLines delay_lines;
+  WavWriter odd_wav_writer(1, kSampleRate, 5);
+  odd_wav_writer.Open("oscillator_float_odd_blocks.wav");
+  osc.Init(kSampleRate);
+  osc.set_delay_lines(&delay_lines);
+  osc.set_shape(MACRO_OSC_SHAPE_VOWEL_FOF);
+  size_t block_size = 1;
+  for (uint32_t i = 0; i < kSampleRate * 5; i += block_size) {
+    float buffer[kAudioBlockSize * 2];
+    block_size = 1 + ((i / 7) % 24) * 2;
+    if (i + block_size > kSampleRate * 5) {
+      block_size = kSampleRate * 5 - i;
+    }
+    osc.set_pitch((48 << 7) + (i >> 12));
+    osc.Render(NULL, buffer, block_size);
+    odd_wav_writer.Write(buffer, block_size, 32767.0f);
+  }
+}
+
+void TestWavetableRendering() {
+  const uint32_t kHostSampleRate = 48000;
+  static WavetableCache cache;
+  FloatMacroOscillator osc;
+  WavWriter wav_writer(1, kHostSampleRate, 10);
+  wav_writer.Open("oscillator_wavetable.wav");
+
+  cache.Init();
+  osc.Init(kHostSampleRate);
+  osc.set_wavetable_cache(&cache);
+  osc.set_shape(MACRO_OSC_SHAPE_WAVETABLES);
+
+  // Sweeps up to the top of the pitch range, where the naive wavetable
+  // playback aliases most.
+  for (uint32_t i = 0; i < kHostSampleRate * 10 / kAudioBlockSize; ++i) {
+    float buffer[kAudioBlockSize];
+    osc.set_parameters((i * 4) & 32767, 12000);
+    osc.set_pitch((36 << 7) + (i >> 1));
+    osc.Render(NULL, buffer, kAudioBlockSize);
+    wav_writer.Write(buffer, kAudioBlockSize, 32767.0f);
+  }
+}
+
+void RenderVoicePool(VoicePool* pool, WavWriter* wav_writer, size_t size) {
+  // Odd block sizes, with no decimation at this sample rate.
+  const size_t kBlockSize = 255;
+  float buffer[kBlockSize];
+  while (size) {
+    size_t block_size = size < kBlockSize ? size : kBlockSize;
+    pool->Render(buffer, block_size);
+    wav_writer->Write(buffer, block_size, 32767.0f / 4.0f);
+    size -= block_size;
+  }
+}
+
+void TestVoicePool() {
+  const uint32_t kHostSampleRate = 88200;
+  static DelayLines arena[2];
+  static VoicePool pool;
+  WavWriter wav_writer(1, kHostSampleRate, 5);
+  wav_writer.Open("voice_pool.wav");
+  
+  pool.Init(kHostSampleRate, 4, arena, 2);
+  pool.set_envelope(0, 127);
+  
+  // Two physical models take the whole arena; a third one steals the delay
+  // lines of the oldest of them.
+  pool.set_shape(MACRO_OSC_SHAPE_PLUCKED);
+  pool.NoteOn(60, 60 << 7);
+  pool.NoteOn(64, 64 << 7);
+  RenderVoicePool(&pool, &wav_writer, 4410);
+  pool.NoteOn(67, 67 << 7);
+  RenderVoicePool(&pool, &wav_writer, 4410);
+  printf("arena exhausted: %zu voices, %zu free delay lines (2, 0)\n",
+         pool.num_active_voices(), pool.num_free_delay_lines());
+  
+  // Other shapes give the delay lines back, fill the remaining voices, then
+  // steal the oldest one.
+  pool.set_shape(MACRO_OSC_SHAPE_VOWEL_FOF);
+  pool.NoteOn(72, 72 << 7);
+  pool.NoteOn(76, 76 << 7);
+  RenderVoicePool(&pool, &wav_writer, 4410);
+  pool.NoteOn(79, 79 << 7);
+  RenderVoicePool(&pool, &wav_writer, 4411);
+  printf("voices stolen: %zu voices, %zu free delay lines (4, 2)\n",
+         pool.num_active_voices(), pool.num_free_delay_lines());
+  
+  // The AD envelopes run their course; a shorter decay frees the voices.
+  pool.set_envelope(0, 40);
+  uint8_t notes[] = { 60, 64, 67, 72, 76, 79 };
+  for (size_t i = 0; i < sizeof(notes); ++i) {
+    pool.NoteOff(notes[i]);
+  }
+  size_t remaining = kHostSampleRate * 5 - 4410 * 3 - 4411;
+  while (remaining >= 37 && pool.num_active_voices()) {
+    RenderVoicePool(&pool, &wav_writer, 37);
+    remaining -= 37;
+  }
+  RenderVoicePool(&pool, &wav_writer, remaining);
+  printf("released: %zu voices, %zu free delay lines (0, 2)\n",
+         pool.num_active_voices(), pool.num_free_delay_lines());
+}
+
 void TestQuantizer() {
   Quantizer q;
   q.Init();
@@ -68,5 +195,8 @@ void TestQuantizer() {
 
 int main(void) {
   // TestQuantizer();
+  TestFloatRendering();
+  TestWavetableRendering();
+  TestVoicePool();
   TestAudioRendering();
 }
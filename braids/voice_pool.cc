@@ -0,0 +1,230 @@
+// Copyright 2012 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+//
+// Pool of float macro-oscillator voices for polyphonic hosts.
+
+#include "braids/voice_pool.h"
+
+#include <algorithm>
+
+namespace braids {
+
+using namespace std;
+
+// The firmware updates its envelope once per 24-sample block at 96kHz.
+const float kEnvelopeRate = 4000.0f;
+
+void VoicePool::Init(
+    float sample_rate,
+    size_t num_voices,
+    DelayLines* arena,
+    size_t arena_size) {
+  num_voices_ = min(num_voices, kMaxNumVoices);
+  arena_size_ = min(arena_size, kMaxNumVoices);
+  num_free_delay_lines_ = arena_size_;
+  for (size_t i = 0; i < arena_size_; ++i) {
+    free_delay_lines_[i] = &arena[i];
+  }
+  
+  for (size_t i = 0; i < num_voices_; ++i) {
+    Voice* v = &voice_[i];
+    v->oscillator.Init(sample_rate);
+    v->envelope.Init();
+    v->envelope.Trigger(ENV_SEGMENT_DEAD);
+    v->delay_lines = NULL;
+    v->timestamp = 0;
+    v->gain = 0.0f;
+    v->note = 0;
+    v->gate = false;
+    v->active = false;
+  }
+  
+  float block_size = sample_rate / kEnvelopeRate + 0.5f;
+  CONSTRAIN(block_size, 1.0f, static_cast<float>(kMaxEnvelopeBlockSize));
+  envelope_block_size_ = static_cast<size_t>(block_size);
+  
+  timestamp_ = 0;
+  shape_ = MACRO_OSC_SHAPE_CSAW;
+  set_shape(shape_);
+  set_envelope(0, 80);
+}
+
+void VoicePool::set_shape(MacroOscillatorShape shape) {
+  shape_ = shape;
+  const bool uses_delay_lines = MacroOscillator::uses_delay_lines(shape);
+  for (size_t i = 0; i < num_voices_; ++i) {
+    Voice* v = &voice_[i];
+    v->oscillator.set_shape(shape);
+    if (!uses_delay_lines) {
+      GiveDelayLines(v);
+    } else if (v->active && !v->delay_lines) {
+      TakeDelayLines(v);
+      // No room left in the arena: this voice would be silent anyway.
+      v->active = v->delay_lines != NULL;
+    }
+  }
+}
+
+void VoicePool::set_parameters(int16_t parameter_1, int16_t parameter_2) {
+  for (size_t i = 0; i < num_voices_; ++i) {
+    voice_[i].oscillator.set_parameters(parameter_1, parameter_2);
+  }
+}
+
+void VoicePool::set_wavetable_cache(const WavetableCache* wavetable_cache) {
+  for (size_t i = 0; i < num_voices_; ++i) {
+    voice_[i].oscillator.set_wavetable_cache(wavetable_cache);
+  }
+}
+
+void VoicePool::set_envelope(int32_t attack, int32_t decay) {
+  CONSTRAIN(attack, 0, LUT_ENV_PORTAMENTO_INCREMENTS_SIZE - 1);
+  CONSTRAIN(decay, 0, LUT_ENV_PORTAMENTO_INCREMENTS_SIZE - 1);
+  for (size_t i = 0; i < num_voices_; ++i) {
+    voice_[i].envelope.Update(attack, decay);
+  }
+}
+
+VoicePool::Voice* VoicePool::FindVictim(bool needs_delay_lines) {
+  // With the arena exhausted, only the voices holding delay lines can make
+  // room for a physical model.
+  const bool must_hold_delay_lines = needs_delay_lines &&
+      num_free_delay_lines_ == 0 && arena_size_ != 0;
+  Voice* victim = NULL;
+  int victim_priority = 0;
+  for (size_t i = 0; i < num_voices_; ++i) {
+    Voice* v = &voice_[i];
+    if (must_hold_delay_lines && !v->delay_lines) {
+      continue;
+    }
+    int priority = !v->active ? 0 : (!v->gate ? 1 : 2);
+    if (!victim ||
+        priority < victim_priority ||
+        (priority == victim_priority && v->timestamp < victim->timestamp)) {
+      victim = v;
+      victim_priority = priority;
+    }
+  }
+  return victim;
+}
+
+void VoicePool::GiveDelayLines(Voice* voice) {
+  if (voice->delay_lines) {
+    free_delay_lines_[num_free_delay_lines_++] = voice->delay_lines;
+    voice->delay_lines = NULL;
+    voice->oscillator.set_delay_lines(NULL);
+  }
+}
+
+void VoicePool::TakeDelayLines(Voice* voice) {
+  if (!voice->delay_lines && num_free_delay_lines_) {
+    voice->delay_lines = free_delay_lines_[--num_free_delay_lines_];
+    voice->oscillator.set_delay_lines(voice->delay_lines);
+  }
+}
+
+void VoicePool::NoteOn(uint8_t note, int16_t pitch) {
+  const bool needs_delay_lines = MacroOscillator::uses_delay_lines(shape_);
+  
+  // Retrigger the voice already playing this note, if any.
+  Voice* v = NULL;
+  for (size_t i = 0; i < num_voices_; ++i) {
+    if (voice_[i].active && voice_[i].note == note) {
+      v = &voice_[i];
+      break;
+    }
+  }
+  if (!v) {
+    v = FindVictim(needs_delay_lines);
+    if (!v) {
+      return;
+    }
+  }
+  if (needs_delay_lines) {
+    TakeDelayLines(v);
+  }
+  
+  v->note = note;
+  v->gate = true;
+  v->active = true;
+  v->timestamp = ++timestamp_;
+  v->oscillator.set_pitch(pitch);
+  v->oscillator.Strike();
+  v->envelope.Trigger(ENV_SEGMENT_ATTACK);
+}
+
+void VoicePool::NoteOff(uint8_t note) {
+  for (size_t i = 0; i < num_voices_; ++i) {
+    if (voice_[i].active && voice_[i].note == note) {
+      voice_[i].gate = false;
+    }
+  }
+}
+
+size_t VoicePool::num_active_voices() const {
+  size_t n = 0;
+  for (size_t i = 0; i < num_voices_; ++i) {
+    n += voice_[i].active ? 1 : 0;
+  }
+  return n;
+}
+
+void VoicePool::Render(float* out, size_t size) {
+  fill(&out[0], &out[size], 0.0f);
+  for (size_t i = 0; i < num_voices_; ++i) {
+    if (voice_[i].active) {
+      RenderVoice(&voice_[i], out, size);
+    }
+  }
+}
+
+void VoicePool::RenderVoice(Voice* voice, float* out, size_t size) {
+  while (size) {
+    const size_t n = min(size, envelope_block_size_);
+    const float gain = static_cast<float>(voice->envelope.Render()) / 65535.0f;
+    voice->oscillator.Render(NULL, buffer_, n);
+    
+    // Ramp the gain across the block to avoid zipper noise.
+    const float increment = (gain - voice->gain) / static_cast<float>(n);
+    float g = voice->gain;
+    for (size_t i = 0; i < n; ++i) {
+      g += increment;
+      out[i] += buffer_[i] * g;
+    }
+    voice->gain = gain;
+    out += n;
+    size -= n;
+    
+    if (voice->envelope.segment() == ENV_SEGMENT_DEAD && gain == 0.0f) {
+      voice->active = false;
+      GiveDelayLines(voice);
+      break;
+    }
+  }
+}
+
+}  // namespace braids
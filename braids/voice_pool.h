@@ -0,0 +1,115 @@
+// Copyright 2012 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+//
+// Pool of float macro-oscillator voices for polyphonic hosts.
+//
+// The delay lines used by the comb filter and physical models are taken from
+// a shared arena, only by the voices which need them. A note is given to a
+// free voice, or stolen from the least recently triggered voice, released
+// voices going first. When the arena is exhausted, a voice playing a
+// physical model steals from the voices holding delay lines.
+
+#ifndef BRAIDS_VOICE_POOL_H_
+#define BRAIDS_VOICE_POOL_H_
+
+#include "stmlib/stmlib.h"
+
+#include "braids/envelope.h"
+#include "braids/float_macro_oscillator.h"
+
+namespace braids {
+
+const size_t kMaxNumVoices = 16;
+const size_t kMaxEnvelopeBlockSize = 64;
+
+class VoicePool {
+ public:
+  VoicePool() { }
+  ~VoicePool() { }
+  
+  // arena points to arena_size DelayLines. With an arena smaller than the
+  // number of voices, the physical models have a lower polyphony.
+  void Init(
+      float sample_rate,
+      size_t num_voices,
+      DelayLines* arena,
+      size_t arena_size);
+  
+  void set_shape(MacroOscillatorShape shape);
+  void set_parameters(int16_t parameter_1, int16_t parameter_2);
+  
+  // A single cache is enough for all the voices.
+  void set_wavetable_cache(const WavetableCache* wavetable_cache);
+  
+  // Same units as the AD envelope settings of the module (0 to 127).
+  void set_envelope(int32_t attack, int32_t decay);
+  
+  void NoteOn(uint8_t note, int16_t pitch);
+  void NoteOff(uint8_t note);
+  
+  // Writes the mix of all active voices.
+  void Render(float* out, size_t size);
+  
+  size_t num_active_voices() const;
+  inline size_t num_free_delay_lines() const { return num_free_delay_lines_; }
+  
+ private:
+  struct Voice {
+    FloatMacroOscillator oscillator;
+    Envelope envelope;
+    DelayLines* delay_lines;
+    uint32_t timestamp;
+    float gain;
+    uint8_t note;
+    bool gate;
+    bool active;
+  };
+  
+  Voice* FindVictim(bool needs_delay_lines);
+  void GiveDelayLines(Voice* voice);
+  void TakeDelayLines(Voice* voice);
+  void RenderVoice(Voice* voice, float* out, size_t size);
+  
+  Voice voice_[kMaxNumVoices];
+  size_t num_voices_;
+  
+  DelayLines* free_delay_lines_[kMaxNumVoices];
+  size_t num_free_delay_lines_;
+  size_t arena_size_;
+  
+  MacroOscillatorShape shape_;
+  uint32_t timestamp_;
+  size_t envelope_block_size_;
+  
+  float buffer_[kMaxEnvelopeBlockSize];
+  
+  DISALLOW_COPY_AND_ASSIGN(VoicePool);
+};
+
+}  // namespace braids
+
+#endif // BRAIDS_VOICE_POOL_H_
@@ -0,0 +1,93 @@
+// Copyright 2012 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Float, band-limited copy of the 8-bit wavetables.
+
+#include "braids/wavetable_cache.h"
+
+#include "braids/resources.h"
+
+namespace braids {
+
+const size_t kNumHarmonics = kWaveSize / 2;
+
+void WavetableCache::Init() {
+  float cosine[kWaveSize];
+  float sine[kWaveSize];
+  for (size_t i = 0; i < kWaveSize; ++i) {
+    float t = 2.0f * M_PI * static_cast<float>(i) / kWaveSize;
+    cosine[i] = cosf(t);
+    sine[i] = sinf(t);
+  }
+
+  for (size_t w = 0; w < kNumWaves; ++w) {
+    // Same scale as the fixed-point oscillators, where a wave sample s is
+    // rendered as (s << 8) - 32768.
+    const uint8_t* source = wt_waves + w * (kWaveSize + 1);
+    float* level_0 = &data_[w * kNumWaveLevels * kWaveStride];
+    for (size_t i = 0; i < kWaveSize; ++i) {
+      level_0[i] = static_cast<float>(source[i]) / 128.0f - 1.0f;
+    }
+
+    // The upper levels are resynthesized from the spectrum of the wave.
+    float re[kNumHarmonics + 1];
+    float im[kNumHarmonics + 1];
+    for (size_t h = 0; h <= kNumHarmonics; ++h) {
+      float sum_re = 0.0f;
+      float sum_im = 0.0f;
+      for (size_t i = 0; i < kWaveSize; ++i) {
+        size_t k = (h * i) % kWaveSize;
+        sum_re += level_0[i] * cosine[k];
+        sum_im += level_0[i] * sine[k];
+      }
+      float scale = (h == 0 ? 1.0f : 2.0f) / kWaveSize;
+      re[h] = sum_re * scale;
+      im[h] = sum_im * scale;
+    }
+
+    for (size_t level = 1; level < kNumWaveLevels; ++level) {
+      float* destination = level_0 + level * kWaveStride;
+      size_t num_harmonics = kNumHarmonics >> level;
+      for (size_t i = 0; i < kWaveSize; ++i) {
+        float sum = re[0];
+        for (size_t h = 1; h <= num_harmonics; ++h) {
+          size_t k = (h * i) % kWaveSize;
+          sum += re[h] * cosine[k] + im[h] * sine[k];
+        }
+        destination[i] = sum;
+      }
+    }
+
+    for (size_t level = 0; level < kNumWaveLevels; ++level) {
+      float* wave = level_0 + level * kWaveStride;
+      for (size_t i = kWaveSize; i < kWaveStride; ++i) {
+        wave[i] = wave[i - kWaveSize];
+      }
+    }
+  }
+}
+
+}  // namespace braids
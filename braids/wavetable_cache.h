@@ -0,0 +1,77 @@
+// Copyright 2012 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Float, band-limited copy of the 8-bit wavetables.
+//
+// Each wave is stored at kNumWaveLevels levels, level n keeping only the
+// harmonics up to 64 >> n. The cache is about 1MB: build it once and share it
+// between all the oscillators of a host.
+
+#ifndef BRAIDS_WAVETABLE_CACHE_H_
+#define BRAIDS_WAVETABLE_CACHE_H_
+
+#include "stmlib/stmlib.h"
+
+#include <cmath>
+
+namespace braids {
+
+const size_t kWaveSize = 128;
+const size_t kNumWaves = 256;
+const size_t kNumWaveLevels = 7;
+
+// 4 guard samples for the interpolation, keeping each wave 16-byte aligned.
+const size_t kWaveStride = kWaveSize + 4;
+
+class WavetableCache {
+ public:
+  WavetableCache() { }
+  ~WavetableCache() { }
+
+  void Init();
+
+  inline const float* wave(size_t index, size_t level) const {
+    return &data_[(index * kNumWaveLevels + level) * kWaveStride];
+  }
+
+  // Fractional level for a wave played at the given frequency (in cycles per
+  // sample). Both its integral part and the next level are free of partials
+  // above the Nyquist frequency, so crossfading them never aliases.
+  static inline float Level(float frequency) {
+    float level = frequency > 0.0f ? log2f(frequency * 256.0f) : 0.0f;
+    CONSTRAIN(level, 0.0f, static_cast<float>(kNumWaveLevels - 2) + 0.999f);
+    return level;
+  }
+
+ private:
+  float data_[kNumWaves * kNumWaveLevels * kWaveStride];
+
+  DISALLOW_COPY_AND_ASSIGN(WavetableCache);
+};
+
+}  // namespace braids
+
+#endif // BRAIDS_WAVETABLE_CACHE_H_
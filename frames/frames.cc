@@ -138,7 +138,7 @@ int main(void) {
   ui.TryCalibration();
   
   bool trigger_detector_armed = false;
-  uint8_t sequencer_step = 0;
+  uint16_t sequencer_step = 0;
   int32_t dc_offset_frame_modulation = keyframer.dc_offset_frame_modulation();
 
   while (1) {
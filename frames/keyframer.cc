@@ -57,6 +57,7 @@ stmlib::Storage<0x8020000, 4> storage;
 #endif  // TEST
 
 void Keyframer::Init() {
+  cursor_ = 0;
 #ifndef TEST
   if (!storage.ParsimoniousLoad(keyframes_, SETTINGS_SIZE, &version_token_)) {
     for (uint8_t i = 0; i < kNumChannels; ++i) {
@@ -107,6 +108,23 @@ uint16_t Keyframer::FindKeyframe(uint16_t timestamp) {
       KeyframeLess()) - keyframes_;
 }
 
+uint16_t Keyframer::LocateKeyframe(uint16_t timestamp) {
+  uint16_t position = cursor_ < num_keyframes_ ? cursor_ : num_keyframes_;
+  for (uint8_t i = 0; i < 2; ++i) {
+    if (position && keyframes_[position - 1].timestamp >= timestamp) {
+      break;
+    }
+    if (position == num_keyframes_ || \
+        keyframes_[position].timestamp >= timestamp) {
+      cursor_ = position;
+      return position;
+    }
+    ++position;
+  }
+  cursor_ = FindKeyframe(timestamp);
+  return cursor_;
+}
+
 /* static */
 uint16_t Keyframer::ConvertToDacCode(uint16_t gain, uint8_t response) {
   // Exponential response is easy, straight to the 2164.
@@ -218,7 +236,7 @@ void Keyframer::Evaluate(uint16_t timestamp) {
     position_ = -1;
     nearest_keyframe_ = -1;
   } else {
-    uint16_t position = FindKeyframe(timestamp);
+    uint16_t position = LocateKeyframe(timestamp);
     position_ = position;
 
     // Check for the areas before the first keyframe, and after the last
@@ -33,8 +33,13 @@
 
 namespace frames {
   
+// The module stores 64 keyframes. A host can raise this limit, up to 32767.
+#ifndef FRAMES_MAX_NUM_KEYFRAMES
+#define FRAMES_MAX_NUM_KEYFRAMES 64
+#endif  // FRAMES_MAX_NUM_KEYFRAMES
+
 const uint8_t kNumChannels = 4;
-const uint8_t kMaxNumKeyframe = 64;
+const uint16_t kMaxNumKeyframe = FRAMES_MAX_NUM_KEYFRAMES;
 
 const uint8_t kNumPaletteEntries = 8;
 
@@ -139,6 +144,11 @@ class Keyframer {
   
  private:
   uint16_t FindKeyframe(uint16_t timestamp);
+  
+  // Same as FindKeyframe, but starts by checking the segment found by the
+  // previous call, and the next one - which is where the timestamp is during
+  // playback.
+  uint16_t LocateKeyframe(uint16_t timestamp);
    
   Keyframe keyframes_[kMaxNumKeyframe];
   ChannelSettings settings_[kNumChannels];
@@ -166,6 +176,9 @@ class Keyframer {
   
   uint8_t color_[3];
   
+  // Segment found by the last call to LocateKeyframe.
+  uint16_t cursor_;
+  
   static const uint8_t palette_[kNumPaletteEntries][3];
   
   DISALLOW_COPY_AND_ASSIGN(Keyframer);
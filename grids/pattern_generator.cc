@@ -30,43 +30,10 @@ namespace grids {
   
 using namespace avrlib;
 
-/* static */
-Options PatternGenerator::options_;
-
-/* static */
-uint8_t PatternGenerator::pulse_;
-
-/* static */
-uint8_t PatternGenerator::step_;
-
-/* static */
-bool PatternGenerator::first_beat_;
-
-/* static */
-bool PatternGenerator::beat_;
-
-/* static */
-uint8_t PatternGenerator::euclidean_step_[kNumParts];
-
-/* static */
-uint8_t PatternGenerator::state_;
-
-/* static */
-uint8_t PatternGenerator::pulse_duration_counter_;
-
-/* static */
-uint8_t PatternGenerator::part_perturbation_[kNumParts];
-
-/* static */
-PatternGeneratorSettings PatternGenerator::settings_;
-
-/* static */
-uint8_t PatternGenerator::factory_testing_;
-
 /* extern */
 PatternGenerator pattern_generator;
 
-static const prog_uint8_t* drum_map[5][5] = {
+static const prog_uint8_t* drum_map[kDrumMapSize][kDrumMapSize] = {
   { node_10, node_8, node_0, node_9, node_11 },
   { node_15, node_7, node_13, node_12, node_6 },
   { node_18, node_14, node_4, node_5, node_3 },
@@ -95,7 +62,52 @@ uint8_t PatternGenerator::ReadDrumMap(
 }
 
 /* static */
-void PatternGenerator::EvaluateDrums() {
+uint8_t PatternGenerator::ReadDrumMap(
+    const DrumMapNodes& nodes,
+    uint8_t instrument,
+    uint8_t x,
+    uint8_t y) {
+  uint8_t i = x >> 6;
+  uint8_t j = y >> 6;
+  uint8_t a = nodes.level[i][j][instrument];
+  uint8_t b = nodes.level[i + 1][j][instrument];
+  uint8_t c = nodes.level[i][j + 1][instrument];
+  uint8_t d = nodes.level[i + 1][j + 1][instrument];
+  return U8Mix(U8Mix(a, b, x << 2), U8Mix(c, d, x << 2), y << 2);
+}
+
+/* static */
+void PatternGenerator::ReadDrumMapNodes(uint8_t step, DrumMapNodes* nodes) {
+  nodes->step = step;
+  for (uint8_t i = 0; i < kDrumMapSize; ++i) {
+    for (uint8_t j = 0; j < kDrumMapSize; ++j) {
+      const prog_uint8_t* map = drum_map[i][j] + step;
+      for (uint8_t instrument = 0; instrument < kNumParts; ++instrument) {
+        nodes->level[i][j][instrument] = pgm_read_byte(
+            map + instrument * kStepsPerPattern);
+      }
+    }
+  }
+}
+
+/* static */
+void PatternGenerator::TickClock(
+    PatternGenerator* generators,
+    uint8_t num_generators,
+    uint8_t num_pulses) {
+  DrumMapNodes nodes;
+  nodes.step = 0xff;
+  for (uint8_t i = 0; i < num_generators; ++i) {
+    PatternGenerator* g = &generators[i];
+    if (g->pulse_ == 0 && g->options_.output_mode == OUTPUT_MODE_DRUMS && \
+        g->step_ != nodes.step && !g->drum_pattern_cached()) {
+      ReadDrumMapNodes(g->step_, &nodes);
+    }
+    g->Tick(num_pulses, &nodes);
+  }
+}
+
+void PatternGenerator::EvaluateDrums(const DrumMapNodes* nodes) {
   // At the beginning of a pattern, decide on perturbation levels.
   if (step_ == 0) {
     for (uint8_t i = 0; i < kNumParts; ++i) {
@@ -105,12 +117,39 @@ void PatternGenerator::EvaluateDrums() {
     }
   }
   
-  uint8_t instrument_mask = 1;
   uint8_t x = settings_.options.drums.x;
   uint8_t y = settings_.options.drums.y;
+#ifdef GRIDS_DRUM_PATTERN_CACHE
+  // The interpolated levels are computed once for a given position on the
+  // map, at the first time each step is played.
+  if (x != drum_pattern_x_ || y != drum_pattern_y_) {
+    drum_pattern_x_ = x;
+    drum_pattern_y_ = y;
+    drum_pattern_valid_ = 0;
+  }
+  uint8_t* levels = drum_pattern_[step_];
+  uint32_t step_mask = 1UL << step_;
+  if (!(drum_pattern_valid_ & step_mask)) {
+    for (uint8_t i = 0; i < kNumParts; ++i) {
+      levels[i] = nodes
+          ? ReadDrumMap(*nodes, i, x, y)
+          : ReadDrumMap(step_, i, x, y);
+    }
+    drum_pattern_valid_ |= step_mask;
+  }
+#else
+  uint8_t levels[kNumParts];
+  for (uint8_t i = 0; i < kNumParts; ++i) {
+    levels[i] = nodes
+        ? ReadDrumMap(*nodes, i, x, y)
+        : ReadDrumMap(step_, i, x, y);
+  }
+#endif  // GRIDS_DRUM_PATTERN_CACHE
+  
+  uint8_t instrument_mask = 1;
   uint8_t accent_bits = 0;
   for (uint8_t i = 0; i < kNumParts; ++i) {
-    uint8_t level = ReadDrumMap(step_, i, x, y);
+    uint8_t level = levels[i];
     if (level < 255 - part_perturbation_[i]) {
       level += part_perturbation_[i];
     } else {
@@ -135,7 +174,6 @@ void PatternGenerator::EvaluateDrums() {
   }
 }
 
-/* static */
 void PatternGenerator::EvaluateEuclidean() {
   // Refresh only on sixteenth notes.
   if (step_ & 1) {
@@ -171,13 +209,11 @@ void PatternGenerator::EvaluateEuclidean() {
   }
 }
 
-/* static */
 void PatternGenerator::LoadSettings() {
   options_.unpack(eeprom_read_byte(NULL));
   factory_testing_ = eeprom_read_byte((uint8_t*)(1)) + 1;
 }
 
-/* static */
 void PatternGenerator::SaveSettings() {
   eeprom_write_byte(NULL, options_.pack());
   ++factory_testing_;
@@ -187,8 +223,7 @@ void PatternGenerator::SaveSettings() {
   eeprom_write_byte((uint8_t*)(1), factory_testing_);
 }
 
-/* static */
-void PatternGenerator::Evaluate() {
+void PatternGenerator::Evaluate(const DrumMapNodes* nodes) {
   state_ = 0;
   pulse_duration_counter_ = 0;
   
@@ -209,11 +244,10 @@ void PatternGenerator::Evaluate() {
   if (options_.output_mode == OUTPUT_MODE_EUCLIDEAN) {
     EvaluateEuclidean();
   } else {
-    EvaluateDrums();
+    EvaluateDrums(nodes);
   }
 }
 
-/* static */
 int8_t PatternGenerator::swing_amount() {
   if (options_.swing && output_mode() == OUTPUT_MODE_DRUMS) {
     int8_t value = U8U8MulShift8(settings_.options.drums.randomness, 42 + 1);
@@ -39,6 +39,13 @@ const uint8_t kNumParts = 3;
 const uint8_t kPulsesPerStep = 3;  // 24 ppqn ; 8 steps per quarter note.
 const uint8_t kStepsPerPattern = 32;
 const uint8_t kPulseDuration = 8;  // 8 ticks of the main clock.
+const uint8_t kDrumMapSize = 5;
+
+// The interpolated drum map cache takes 102 bytes per instance, which the 2kB
+// of RAM of the module cannot spare: it is only compiled in host builds.
+#ifndef __AVR__
+#define GRIDS_DRUM_PATTERN_CACHE
+#endif  // __AVR__
 
 struct DrumsSettings {
   uint8_t x;
@@ -113,80 +120,81 @@ struct Options {
   }
 };
 
+// Levels of all the nodes of the drum map at a given step.
+struct DrumMapNodes {
+  uint8_t step;
+  uint8_t level[kDrumMapSize][kDrumMapSize][kNumParts];
+};
+
 class PatternGenerator {
  public:
   PatternGenerator() { }
   ~PatternGenerator() { }
   
-  static inline void Init() {
+  // Restores the options saved in the EEPROM.
+  inline void Init() {
+    InitState();
     LoadSettings();
-    Reset();
+  }
+  
+  // Does not touch the EEPROM: for the instances run by a host.
+  inline void Init(const Options& options) {
+    InitState();
+    options_ = options;
+    factory_testing_ = 5;
   }
 
-  static inline void Reset() {
+  inline void Reset() {
     step_ = 0;
     pulse_ = 0;
     memset(euclidean_step_, 0, sizeof(euclidean_step_));
   }
   
-  static inline void Retrigger() {
-    Evaluate();
+  inline void Retrigger() {
+    Evaluate(NULL);
   }
   
-  static inline void TickClock(uint8_t num_pulses) {
-    Evaluate();
-    beat_ = (step_ & 0x7) == 0;
-    first_beat_ = step_ == 0;
-    
-    pulse_ += num_pulses;
-    
-    // Wrap into ppqn steps.
-    while (pulse_ >= kPulsesPerStep) {
-      pulse_ -= kPulsesPerStep;
-      if (!(step_ & 1)) {
-        for (uint8_t i = 0; i < kNumParts; ++i) {
-          ++euclidean_step_[i];
-        }
-      }
-      ++step_;
-    }
-    
-    // Wrap into step sequence steps.
-    if (step_ >= kStepsPerPattern) {
-      step_ -= kStepsPerPattern;
-    }
+  inline void TickClock(uint8_t num_pulses) {
+    Tick(num_pulses, NULL);
   }
   
-  static inline uint8_t state() {
+  // Clocks num_generators generators driven by the same clock. The drum map
+  // is read once per step for all of them, rather than once per generator.
+  static void TickClock(
+      PatternGenerator* generators,
+      uint8_t num_generators,
+      uint8_t num_pulses);
+  
+  inline uint8_t state() {
     return state_;
   }
-  static inline uint8_t step() { return step_; }
+  inline uint8_t step() { return step_; }
   
-  static inline bool swing() { return options_.swing; }
-  static int8_t swing_amount();
-  static inline bool output_clock() { return options_.output_clock; }
-  static inline bool tap_tempo() { return options_.tap_tempo; }
-  static inline bool gate_mode() { return options_.gate_mode; }
-  static inline OutputMode output_mode() { return options_.output_mode; }
-  static inline ClockResolution clock_resolution() { return options_.clock_resolution; }
+  inline bool swing() { return options_.swing; }
+  int8_t swing_amount();
+  inline bool output_clock() { return options_.output_clock; }
+  inline bool tap_tempo() { return options_.tap_tempo; }
+  inline bool gate_mode() { return options_.gate_mode; }
+  inline OutputMode output_mode() { return options_.output_mode; }
+  inline ClockResolution clock_resolution() { return options_.clock_resolution; }
 
-  static void set_swing(uint8_t value) { options_.swing = value; }  
-  static void set_output_clock(uint8_t value) { options_.output_clock = value; }
-  static void set_tap_tempo(uint8_t value) { options_.tap_tempo = value; }
-  static void set_output_mode(uint8_t value) { 
+  void set_swing(uint8_t value) { options_.swing = value; }  
+  void set_output_clock(uint8_t value) { options_.output_clock = value; }
+  void set_tap_tempo(uint8_t value) { options_.tap_tempo = value; }
+  void set_output_mode(uint8_t value) { 
     options_.output_mode = static_cast<OutputMode>(value);
   }
-  static void set_clock_resolution(uint8_t value) {
+  void set_clock_resolution(uint8_t value) {
     if (value >= CLOCK_RESOLUTION_24_PPQN) {
       value = CLOCK_RESOLUTION_24_PPQN;
     }
     options_.clock_resolution = static_cast<ClockResolution>(value);
   }
-  static void set_gate_mode(bool gate_mode) {
+  void set_gate_mode(bool gate_mode) {
     options_.gate_mode = gate_mode;
   }
   
-  static inline void IncrementPulseCounter() {
+  inline void IncrementPulseCounter() {
     ++pulse_duration_counter_;
     // Zero all pulses after 1ms.
     if (pulse_duration_counter_ >= kPulseDuration && !options_.gate_mode) {
@@ -197,23 +205,23 @@ class PatternGenerator {
     }
   }
   
-  static inline void ClockFallingEdge() {
+  inline void ClockFallingEdge() {
     if (options_.gate_mode) {
       state_ = 0;
     }
   }
   
-  static inline PatternGeneratorSettings* mutable_settings() {
+  inline PatternGeneratorSettings* mutable_settings() {
     return &settings_;
   }
   
-  static bool on_first_beat() { return first_beat_; }
-  static bool on_beat() { return beat_; }
-  static bool factory_testing() { return factory_testing_ < 5; }
+  bool on_first_beat() { return first_beat_; }
+  bool on_beat() { return beat_; }
+  bool factory_testing() { return factory_testing_ < 5; }
 
-  static void SaveSettings();
+  void SaveSettings();
   
-  static inline uint8_t led_pattern() {
+  inline uint8_t led_pattern() {
     uint8_t result = 0;
     if (state_ & 1) {
       result |= LED_BD;
@@ -228,33 +236,95 @@ class PatternGenerator {
   }
   
  private:
-  static void LoadSettings();
-  static void Evaluate();
-  static void EvaluateEuclidean();
-  static void EvaluateDrums();
+  inline void Tick(uint8_t num_pulses, const DrumMapNodes* nodes) {
+    Evaluate(nodes);
+    beat_ = (step_ & 0x7) == 0;
+    first_beat_ = step_ == 0;
+    
+    pulse_ += num_pulses;
+    
+    // Wrap into ppqn steps.
+    while (pulse_ >= kPulsesPerStep) {
+      pulse_ -= kPulsesPerStep;
+      if (!(step_ & 1)) {
+        for (uint8_t i = 0; i < kNumParts; ++i) {
+          ++euclidean_step_[i];
+        }
+      }
+      ++step_;
+    }
+    
+    // Wrap into step sequence steps.
+    if (step_ >= kStepsPerPattern) {
+      step_ -= kStepsPerPattern;
+    }
+  }
+  
+  inline void InitState() {
+    memset(&settings_, 0, sizeof(settings_));
+    memset(part_perturbation_, 0, sizeof(part_perturbation_));
+    state_ = 0;
+    pulse_duration_counter_ = 0;
+    first_beat_ = false;
+    beat_ = false;
+#ifdef GRIDS_DRUM_PATTERN_CACHE
+    drum_pattern_valid_ = 0;
+#endif  // GRIDS_DRUM_PATTERN_CACHE
+    Reset();
+  }
+  
+  void LoadSettings();
+  void Evaluate(const DrumMapNodes* nodes);
+  void EvaluateEuclidean();
+  void EvaluateDrums(const DrumMapNodes* nodes);
   
   static uint8_t ReadDrumMap(
       uint8_t step,
       uint8_t instrument,
       uint8_t x,
       uint8_t y);
+  static uint8_t ReadDrumMap(
+      const DrumMapNodes& nodes,
+      uint8_t instrument,
+      uint8_t x,
+      uint8_t y);
+  static void ReadDrumMapNodes(uint8_t step, DrumMapNodes* nodes);
+  
+  inline bool drum_pattern_cached() const {
+#ifdef GRIDS_DRUM_PATTERN_CACHE
+    return settings_.options.drums.x == drum_pattern_x_ && \
+        settings_.options.drums.y == drum_pattern_y_ && \
+        (drum_pattern_valid_ & (1UL << step_));
+#else
+    return false;
+#endif  // GRIDS_DRUM_PATTERN_CACHE
+  }
 
-  static Options options_;
+  Options options_;
+  
+  uint8_t pulse_;
+  uint8_t step_;
+  uint8_t euclidean_step_[kNumParts];
+  bool first_beat_;
+  bool beat_;
   
-  static uint8_t pulse_;
-  static uint8_t step_;
-  static uint8_t euclidean_step_[kNumParts];
-  static bool first_beat_;
-  static bool beat_;
+  uint8_t state_;
+  uint8_t part_perturbation_[kNumParts];
   
-  static uint8_t state_;
-  static uint8_t part_perturbation_[kNumParts];
+#ifdef GRIDS_DRUM_PATTERN_CACHE
+  // Drum map levels interpolated at drum_pattern_x_, drum_pattern_y_ - only
+  // for the steps flagged in drum_pattern_valid_.
+  uint8_t drum_pattern_[kStepsPerPattern][kNumParts];
+  uint32_t drum_pattern_valid_;
+  uint8_t drum_pattern_x_;
+  uint8_t drum_pattern_y_;
+#endif  // GRIDS_DRUM_PATTERN_CACHE
 
-  static uint8_t pulse_duration_counter_;
+  uint8_t pulse_duration_counter_;
   
-  static uint8_t factory_testing_;
+  uint8_t factory_testing_;
   
-  static PatternGeneratorSettings settings_;
+  PatternGeneratorSettings settings_;
   
   DISALLOW_COPY_AND_ASSIGN(PatternGenerator);
 };
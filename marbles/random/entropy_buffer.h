@@ -0,0 +1,119 @@
+// Copyright 2015 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Single-producer, single-consumer lock-free FIFO of random words. The
+// producer (hardware RNG interrupt, or a host thread collecting entropy) only
+// writes the write index, the consumer only writes the read index. Indices
+// are free-running and wrapped with a mask, so size must be a power of two.
+
+#ifndef MARBLES_RANDOM_ENTROPY_BUFFER_H_
+#define MARBLES_RANDOM_ENTROPY_BUFFER_H_
+
+#include "stmlib/stmlib.h"
+
+namespace marbles {
+
+template<size_t size>
+class EntropyBuffer {
+ public:
+  EntropyBuffer() { }
+  ~EntropyBuffer() { }
+  
+  inline void Init() {
+    read_ptr_ = 0;
+    write_ptr_ = 0;
+  }
+  
+  inline size_t capacity() const { return size; }
+
+  inline size_t readable() const {
+    return static_cast<size_t>(write_ptr_ - read_ptr_);
+  }
+
+  inline size_t writable() const {
+    return size - readable();
+  }
+  
+  // Producer side. Returns false when the buffer is full: the word is
+  // dropped rather than overwriting one that the consumer might be reading.
+  inline bool Write(uint32_t word) {
+    return Write(&word, 1) == 1;
+  }
+  
+  // Producer side. Writes as many words as there is room for, and publishes
+  // them all at once. Returns the number of words written.
+  inline size_t Write(const uint32_t* words, size_t n) {
+    const uint32_t w = write_ptr_;
+    const size_t available = size - static_cast<size_t>(w - read_ptr_);
+    if (n > available) {
+      n = available;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      buffer_[(w + i) & kMask] = words[i];
+    }
+    // Make sure the data is visible before the new write index.
+    __sync_synchronize();
+    write_ptr_ = w + n;
+    return n;
+  }
+  
+  // Consumer side. Reads up to n words and returns the number of words read.
+  inline size_t Read(uint32_t* words, size_t n) {
+    const uint32_t r = read_ptr_;
+    const size_t available = static_cast<size_t>(write_ptr_ - r);
+    if (n > available) {
+      n = available;
+    }
+    // Make sure the data is not read before the write index.
+    __sync_synchronize();
+    for (size_t i = 0; i < n; ++i) {
+      words[i] = buffer_[(r + i) & kMask];
+    }
+    __sync_synchronize();
+    read_ptr_ = r + n;
+    return n;
+  }
+  
+  // Consumer side. Drops all words currently in the buffer.
+  inline void Flush() {
+    read_ptr_ = write_ptr_;
+  }
+  
+ private:
+  enum {
+    kMask = size - 1
+  };
+  
+  uint32_t buffer_[size];
+  volatile uint32_t read_ptr_;
+  volatile uint32_t write_ptr_;
+  
+  DISALLOW_COPY_AND_ASSIGN(EntropyBuffer);
+};
+
+}  // namespace marbles
+
+#endif  // MARBLES_RANDOM_ENTROPY_BUFFER_H_
@@ -28,6 +28,8 @@
 
 #include "marbles/random/output_channel.h"
 
+#include <algorithm>
+
 #include "marbles/random/distributions.h"
 #include "marbles/random/random_sequence.h"
 
@@ -39,8 +41,6 @@ namespace marbles {
 
 using namespace stmlib;
 
-const size_t kNumReacquisitions = 20; // 6.4 samples per millisecond
-
 void OutputChannel::Init() {
   spread_ = 0.5f;
   bias_ = 0.5f;
@@ -65,14 +65,12 @@ void OutputChannel::Init() {
   
   Scale scale;
   scale.Init();
-  for (int i = 0; i < 6; ++i) {
+  for (int i = 0; i < kNumScales; ++i) {
     quantizer_[i].Init(scale);
   }
 }
 
-float OutputChannel::GenerateNewVoltage(RandomSequence* random_sequence) {
-  float u = random_sequence->NextValue(register_mode_, register_value_);
-  
+float OutputChannel::UniformToVoltage(float u) {
   if (register_mode_) {
     return 10.0f * (u - 0.5f) + register_transposition_;
   } else {
@@ -119,26 +117,53 @@ void OutputChannel::Process(
     quantized_voltage_ = Quantize(voltage_, 2.0f * steps_ - 1.0f);
   }
   
-  while (size--) {
-    const float steps = steps_modulation.Next();
-    if (*phase < previous_phase_) {
-      previous_voltage_ = voltage_;
-      voltage_ = GenerateNewVoltage(random_sequence);
-      lag_processor_.ResetRamp();
-      quantized_voltage_ = Quantize(voltage_, 2.0f * steps - 1.0f);
-      if (register_mode_) {
-        reacquisition_counter_ = kNumReacquisitions;
+  while (size) {
+    size_t chunk_size = std::min(size, kMaxBatchSize);
+    
+    // Locate the clock ticks in this chunk, then draw the random values for
+    // all of them at once.
+    uint8_t tick[kMaxBatchSize];
+    size_t num_ticks = 0;
+    float previous_phase = previous_phase_;
+    for (size_t i = 0; i < chunk_size; ++i) {
+      tick[num_ticks] = i;
+      num_ticks += phase[i] < previous_phase ? 1 : 0;
+      previous_phase = phase[i];
+    }
+    
+    float voltage[kMaxBatchSize];
+    if (num_ticks) {
+      random_sequence->NextValues(
+          register_mode_, register_value_, voltage, num_ticks);
+      for (size_t i = 0; i < num_ticks; ++i) {
+        voltage[i] = UniformToVoltage(voltage[i]);
       }
     }
     
-    if (steps >= 0.5f) {
-      *output = quantized_voltage_;
-    } else {
-      const float smoothness = 1.0f - 2.0f * steps;
-      *output = lag_processor_.Process(voltage_, smoothness, *phase);
+    size_t next_tick = 0;
+    for (size_t i = 0; i < chunk_size; ++i) {
+      const float steps = steps_modulation.Next();
+      if (next_tick < num_ticks && tick[next_tick] == i) {
+        previous_voltage_ = voltage_;
+        voltage_ = voltage[next_tick++];
+        lag_processor_.ResetRamp();
+        quantized_voltage_ = Quantize(voltage_, 2.0f * steps - 1.0f);
+        if (register_mode_) {
+          reacquisition_counter_ = kNumReacquisitions;
+        }
+      }
+    
+      if (steps >= 0.5f) {
+        *output = quantized_voltage_;
+      } else {
+        const float smoothness = 1.0f - 2.0f * steps;
+        *output = lag_processor_.Process(voltage_, smoothness, phase[i]);
+      }
+      output += stride;
     }
-    output += stride;
-    previous_phase_ = *phase++;
+    previous_phase_ = phase[chunk_size - 1];
+    phase += chunk_size;
+    size -= chunk_size;
   }
 }
 
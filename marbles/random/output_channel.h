@@ -38,6 +38,8 @@ namespace marbles {
 
 class RandomSequence;
 
+const size_t kNumReacquisitions = 20; // 6.4 samples per millisecond
+
 struct ScaleOffset {
   ScaleOffset(float s, float o) {
     scale = s;
@@ -106,7 +108,7 @@ class OutputChannel {
   }
   
  private:
-  float GenerateNewVoltage(RandomSequence* random_sequence);
+  float UniformToVoltage(float u);
   
   float spread_;
   float bias_;
@@ -129,7 +131,7 @@ class OutputChannel {
   
   LagProcessor lag_processor_;
   
-  Quantizer quantizer_[6];
+  Quantizer quantizer_[kNumScales];
   
   DISALLOW_COPY_AND_ASSIGN(OutputChannel);
 };
@@ -82,6 +82,22 @@ void Quantizer::Init(const Scale& scale) {
     level_[t].bitmask = bitmask;
     level_[t].first = first;
     level_[t].last = last;
+    
+    // For each bin, find the last active degree strictly below the start of
+    // the bin. The margin keeps a degree sitting on the edge of a bin out of
+    // it, whatever the rounding of the bin index.
+    for (int bin = 0; bin < kQuantizerTableSize; ++bin) {
+      const float bin_start = static_cast<float>(bin) * base_interval_ / \
+          static_cast<float>(kQuantizerTableSize);
+      const float margin = base_interval_ * 1.0e-4f;
+      int8_t start = -1;
+      for (int i = 0; i < n; ++i) {
+        if ((bitmask & (1 << i)) && voltage_[i] < bin_start - margin) {
+          start = i;
+        }
+      }
+      level_[t].start[bin] = start;
+    }
   }
   
   level_quantizer_.Init();
@@ -98,38 +114,7 @@ float Quantizer::Process(float value, float amount, bool hysteresis) {
     if (hysteresis) {
       value += feedback_[level];
     }
-
-    const float note = value * base_interval_reciprocal_;
-    MAKE_INTEGRAL_FRACTIONAL(note);
-    if (value < 0.0f) {
-      note_integral -= 1;
-      note_fractional += 1.0f;
-    }
-    note_fractional *= base_interval_;
-    
-    // Search for the tightest upper/lower bound in the set of available
-    // voltages. stl::upper_bound / stl::lower_bound wouldn't work here
-    // because some entries are masked.
-    Level l = level_[level];
-    float a = voltage_[l.last] - base_interval_;
-    float b = voltage_[l.first] + base_interval_;
-
-    uint16_t bitmask = l.bitmask;
-    for (int i = 0; i < num_degrees_; ++i) {
-      if (bitmask & 1) {
-        float v = voltage_[i];
-        if (note_fractional > v) {
-          a = v;
-        } else {
-          b = v;
-          break;
-        }
-      }
-      bitmask >>= 1;
-    }
-    
-    quantized_voltage = note_fractional < (a + b) * 0.5f ? a : b;
-    quantized_voltage += static_cast<float>(note_integral) * base_interval_;
+    quantized_voltage = Quantize(value, level);
     feedback_[level] = (quantized_voltage - raw_value) * 0.25f;
   }
   return quantized_voltage;
@@ -30,6 +30,7 @@
 #define MARBLES_RANDOM_QUANTIZER_H_
 
 #include "stmlib/stmlib.h"
+#include "stmlib/dsp/dsp.h"
 #include "stmlib/dsp/hysteresis_quantizer.h"
 
 #include "marbles/random/distributions.h"
@@ -39,6 +40,12 @@ namespace marbles {
 
 const int kMaxDegrees = 16;
 const int kNumThresholds = 7;
+const int kNumScales = 6;
+
+// Number of bins per base interval in the quantization tables. Each bin
+// stores the last active degree below it, from which the search starts, so
+// the quantization is exact whatever the spacing of the degrees.
+const int kQuantizerTableSize = 16;
 
 struct Degree {
   float voltage;
@@ -98,11 +105,55 @@ class Quantizer {
 
   float Process(float value, float amount, bool hysteresis);
   
+  // Quantizes value to the set of degrees active at a given level (0 to
+  // kNumThresholds - 1). Does not modify the state of the quantizer, so a
+  // single instance can be shared by several channels.
+  inline float Quantize(float value, int level) const {
+    const float note = value * base_interval_reciprocal_;
+    MAKE_INTEGRAL_FRACTIONAL(note);
+    if (value < 0.0f) {
+      note_integral -= 1;
+      note_fractional += 1.0f;
+    }
+    
+    int32_t bin = static_cast<int32_t>(
+        note_fractional * static_cast<float>(kQuantizerTableSize));
+    bin = bin >= kQuantizerTableSize ? kQuantizerTableSize - 1 : bin;
+    note_fractional *= base_interval_;
+    
+    // Search for the tightest upper/lower bound in the set of available
+    // voltages, skipping the degrees known to be below the bin.
+    const Level& l = level_[level];
+    const int8_t start = l.start[bin];
+    float a = voltage_[l.last] - base_interval_;
+    float b = voltage_[l.first] + base_interval_;
+    uint32_t bitmask = l.bitmask;
+    if (start >= 0) {
+      a = voltage_[start];
+      bitmask &= ~((2UL << start) - 1);
+    }
+    while (bitmask) {
+      float v = voltage_[__builtin_ctz(bitmask)];
+      if (note_fractional > v) {
+        a = v;
+      } else {
+        b = v;
+        break;
+      }
+      bitmask &= bitmask - 1;
+    }
+    
+    float quantized_voltage = note_fractional < (a + b) * 0.5f ? a : b;
+    return quantized_voltage + static_cast<float>(note_integral) * \
+        base_interval_;
+  }
+  
  private:
   struct Level {
     uint16_t bitmask;  // bitmask of active degrees.
     uint8_t first;  // index of the first active degree.
     uint8_t last;   // index of the last active degree.
+    int8_t start[kQuantizerTableSize];  // last active degree below each bin.
   };
   float voltage_[kMaxDegrees];
 
@@ -26,14 +26,16 @@
 //
 // Pseudo-random generator used as a fallback when we need more random values
 // than available in the hardware RNG buffer.
+//
+// This is a counter-based generator: the n-th word is a hash of a Weyl
+// sequence indexed by n, so words do not depend on each other and a whole
+// block of them can be computed in a vectorizable loop.
 
 #ifndef MARBLES_RANDOM_RANDOM_GENERATOR_H_
 #define MARBLES_RANDOM_RANDOM_GENERATOR_H_
 
 #include "stmlib/stmlib.h"
 
-#include "stmlib/utils/ring_buffer.h"
-
 namespace marbles {
 
 class RandomGenerator {
@@ -42,20 +44,42 @@ class RandomGenerator {
   ~RandomGenerator() { }
   
   inline void Init(uint32_t seed) {
-    state_ = seed;
+    key_ = Hash(seed);
+    counter_ = 0;
   }
   
   inline void Mix(uint32_t word) {
-    // state_ ^= word;
+    // key_ ^= word;
   }
   
   inline uint32_t GetWord() {
-    state_ = state_ * 1664525L + 1013904223L;
-    return state_;
+    return Hash(key_ + kGoldenRatio * counter_++);
+  }
+  
+  inline void GetWords(uint32_t* out, size_t size) {
+    const uint32_t key = key_;
+    const uint32_t counter = counter_;
+    for (size_t i = 0; i < size; ++i) {
+      out[i] = Hash(key + kGoldenRatio * (counter + static_cast<uint32_t>(i)));
+    }
+    counter_ = counter + static_cast<uint32_t>(size);
   }
  
  private:
-  uint32_t state_;
+  static const uint32_t kGoldenRatio = 0x9e3779b9;
+  
+  // Integer hash with low bias, from Chris Wellons' hash-prospector.
+  static inline uint32_t Hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+  }
+  
+  uint32_t key_;
+  uint32_t counter_;
   
   DISALLOW_COPY_AND_ASSIGN(RandomGenerator);
 };
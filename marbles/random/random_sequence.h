@@ -42,6 +42,9 @@ const int kHistoryBufferSize = 16;
 
 const float kMaxUint32 = 4294967296.0f;
 
+// Maximum number of values generated by a single call to NextValues().
+const size_t kMaxBatchSize = 32;
+
 class RandomSequence {
  public:
   RandomSequence() { }
@@ -52,7 +55,7 @@ class RandomSequence {
     for (int i = 0; i < kDejaVuBufferSize; ++i) {
       loop_[i] = random_stream_->GetFloat();
     }
-    std::fill(&history_[0], &history_[kHistoryBufferSize], 0.0f);
+    std::fill(&history_[0], &history_[2 * kHistoryBufferSize], 0.0f);
 
     loop_write_head_ = 0;
     length_ = 8;
@@ -78,7 +81,7 @@ class RandomSequence {
         &loop_[0]);
     std::copy(
         &source.history_[0],
-        &source.history_[kHistoryBufferSize],
+        &source.history_[2 * kHistoryBufferSize],
         &history_[0]);
     
     loop_write_head_ = source.loop_write_head_;
@@ -152,7 +155,7 @@ class RandomSequence {
       result = 0.5f;
     }
     if (redo_write_history_ptr_) {
-      *redo_write_history_ptr_ = result;
+      WriteHistory(redo_write_history_ptr_, result);
     }
     return result;
   }
@@ -189,20 +192,28 @@ class RandomSequence {
         }
       }
     }
-    uint32_t i = loop_write_head_ + kDejaVuBufferSize - length_ + step_;
-    redo_read_ptr_ = &loop_[i % kDejaVuBufferSize];
-    float result = *redo_read_ptr_;
-    if (result >= 1.0f) {
-      result -= 1.0f;
-    } else if (deterministic) {
-      // We ask for a deterministic value (shift register), but the loop
-      // contain random values. return 0.5f in this case!
-      result = 0.5f;
+    return ReadLoop(deterministic);
+  }
+  
+  // Batch version of NextValue(). The random numbers needed by the whole batch
+  // are pulled from the random stream at once, and values replayed from the
+  // history are copied from a contiguous span of the (mirrored) history
+  // buffer.
+  inline void NextValues(
+      bool deterministic,
+      float value,
+      float* destination,
+      size_t size) {
+    while (size) {
+      size_t n = std::min(size, kMaxBatchSize);
+      if (replay_head_ >= 0) {
+        ReplayValues(destination, n);
+      } else {
+        GenerateValues(deterministic, value, destination, n);
+      }
+      destination += n;
+      size -= n;
     }
-    redo_write_history_ptr_ = &history_[record_head_];
-    *redo_write_history_ptr_ = result;
-    record_head_ = (record_head_ + 1) % kHistoryBufferSize;
-    return result;
   }
   
   inline void NextVector(float* destination, size_t size) {
@@ -226,6 +237,13 @@ class RandomSequence {
     step_ = step_ % length;
   }
   
+  // Value returned by the age-th most recent call to NextValue (0 being the
+  // most recent one), with age < kHistoryBufferSize.
+  inline float history(uint32_t age) const {
+    return history_[(record_head_ - 1 - age + 2 * kHistoryBufferSize) % \
+        kHistoryBufferSize];
+  }
+  
   inline float deja_vu() const {
     return deja_vu_;
   }
@@ -239,9 +257,92 @@ class RandomSequence {
   }
   
  private:
+  inline float ReadLoop(bool deterministic) {
+    uint32_t i = loop_write_head_ + kDejaVuBufferSize - length_ + step_;
+    redo_read_ptr_ = &loop_[i % kDejaVuBufferSize];
+    float result = *redo_read_ptr_;
+    if (result >= 1.0f) {
+      result -= 1.0f;
+    } else if (deterministic) {
+      // We ask for a deterministic value (shift register), but the loop
+      // contain random values. return 0.5f in this case!
+      result = 0.5f;
+    }
+    redo_write_history_ptr_ = &history_[record_head_];
+    WriteHistory(redo_write_history_ptr_, result);
+    record_head_ = (record_head_ + 1) % kHistoryBufferSize;
+    return result;
+  }
+  
+  // The history buffer is stored twice, so that any run of up to
+  // kHistoryBufferSize consecutive entries can be read without wrapping.
+  inline void WriteHistory(float* p, float value) {
+    p[0] = value;
+    p[kHistoryBufferSize] = value;
+  }
+  
+  inline void ReplayValues(float* destination, size_t size) {
+    while (size) {
+      replay_head_ = (replay_head_ + 1) % kHistoryBufferSize;
+      uint32_t h = (replay_head_ - 1 - replay_shift_ + \
+          2 * kHistoryBufferSize) % kHistoryBufferSize;
+      size_t n = std::min(size, static_cast<size_t>(kHistoryBufferSize));
+      const float* source = &history_[h];
+      if (!replay_hash_) {
+        std::copy(&source[0], &source[n], destination);
+      } else {
+        const uint32_t hash = replay_hash_;
+        for (size_t i = 0; i < n; ++i) {
+          uint32_t word = static_cast<float>(source[i] * kMaxUint32);
+          word = (word ^ hash) * 1664525L + 1013904223L;
+          destination[i] = static_cast<float>(word) / kMaxUint32;
+        }
+      }
+      replay_head_ = (replay_head_ + n - 1) % kHistoryBufferSize;
+      destination += n;
+      size -= n;
+    }
+  }
+  
+  inline void GenerateValues(
+      bool deterministic,
+      float value,
+      float* destination,
+      size_t size) {
+    // Two random numbers per step: one for the mutation decision, one for
+    // the new value or the jump position.
+    float u[2 * kMaxBatchSize];
+    random_stream_->GetFloats(u, 2 * size);
+    
+    const float p_sqrt = 2.0f * deja_vu_ - 1.0f;
+    const float p = p_sqrt * p_sqrt;
+    
+    for (size_t i = 0; i < size; ++i) {
+      const bool mutate = u[2 * i] < p;
+      const float v = u[2 * i + 1];
+      if (mutate && deja_vu_ <= 0.5f) {
+        redo_write_ptr_ = &loop_[loop_write_head_];
+        *redo_write_ptr_ = deterministic ? 1.0f + value : v;
+        loop_write_head_ = (loop_write_head_ + 1) % kDejaVuBufferSize;
+        step_ = length_ - 1;
+      } else {
+        redo_write_ptr_ = NULL;
+        if (mutate) {
+          step_ = static_cast<int>(v * static_cast<float>(length_));
+        } else {
+          step_ = step_ + 1;
+          if (step_ >= length_) {
+            step_ = 0;
+          }
+        }
+      }
+      destination[i] = ReadLoop(deterministic);
+    }
+  }
+  
   RandomStream* random_stream_;
   float loop_[kDejaVuBufferSize];
-  float history_[kHistoryBufferSize];
+  float history_[2 * kHistoryBufferSize];
   int loop_write_head_;
   int length_;
   int step_;
@@ -32,12 +32,13 @@
 
 #include "stmlib/stmlib.h"
 
-#include "stmlib/utils/ring_buffer.h"
-
+#include "marbles/random/entropy_buffer.h"
 #include "marbles/random/random_generator.h"
 
 namespace marbles {
 
+const size_t kEntropyBufferSize = 128;
+
 class RandomStream {
  public:
   RandomStream() { }
@@ -47,19 +48,21 @@ class RandomStream {
     fallback_generator_ = fallback_generator;
     buffer_.Init();
   }
-
+  
+  // Write() can be called from a different thread or interrupt than the
+  // Get*() methods. When the buffer is full, new entropy is discarded.
   inline void Write(uint32_t value) {
-    // buffer_.Swallow(1);
-    // buffer_.Overwrite(value);
-    if (buffer_.writable()) {
-      buffer_.Overwrite(value);
-    }
-    fallback_generator_->Mix(value);
+    buffer_.Write(value);
+  }
+  
+  inline size_t Write(const uint32_t* values, size_t size) {
+    return buffer_.Write(values, size);
   }
   
   inline uint32_t GetWord() {
-    if (buffer_.readable()) {
-      return buffer_.ImmediateRead();
+    uint32_t word;
+    if (buffer_.Read(&word, 1)) {
+      return word;
     } else {
       return fallback_generator_->GetWord();
     }
@@ -70,8 +73,30 @@ class RandomStream {
     return static_cast<float>(word) / 4294967296.0f;
   }
   
+  // Fills a block with random words, taking as many as possible from the
+  // entropy buffer and completing with the fallback generator.
+  inline void GetWords(uint32_t* out, size_t size) {
+    size_t read = buffer_.Read(out, size);
+    if (read < size) {
+      fallback_generator_->GetWords(out + read, size - read);
+    }
+  }
+  
+  inline void GetFloats(float* out, size_t size) {
+    uint32_t words[32];
+    while (size) {
+      size_t n = size > 32 ? 32 : size;
+      GetWords(words, n);
+      for (size_t i = 0; i < n; ++i) {
+        out[i] = static_cast<float>(words[i]) / 4294967296.0f;
+      }
+      out += n;
+      size -= n;
+    }
+  }
+  
  private:
-  stmlib::RingBuffer<uint32_t, 128> buffer_;
+  EntropyBuffer<kEntropyBufferSize> buffer_;
   RandomGenerator* fallback_generator_;
   
   DISALLOW_COPY_AND_ASSIGN(RandomStream);
@@ -0,0 +1,259 @@
+// Copyright 2015 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Generator for a large number of X outputs sharing the same clock.
+
+#include "marbles/random/wide_x_generator.h"
+
+#include <algorithm>
+
+#include "stmlib/dsp/dsp.h"
+#include "stmlib/dsp/units.h"
+
+#include "marbles/random/distributions.h"
+#include "marbles/resources.h"
+
+namespace marbles {
+
+using namespace std;
+using namespace stmlib;
+
+void WideXGenerator::Init(RandomStream* random_stream, size_t num_channels) {
+  num_channels_ = min(num_channels, kMaxNumWideChannels);
+  sequence_.Init(random_stream);
+  
+  Scale scale;
+  scale.Init();
+  for (int i = 0; i < kNumScales; ++i) {
+    quantizer_[i].Init(scale);
+  }
+  
+  scale_offset_ = ScaleOffset(10.0f, -5.0f);
+  scale_index_ = 0;
+  register_mode_ = false;
+  register_value_ = 0.0f;
+  
+  previous_phase_ = 0.0f;
+  reacquisition_counter_ = 0;
+  
+  for (size_t i = 0; i < kMaxNumWideChannels; ++i) {
+    // Channel 0 gets the values from the random sequence, the other channels
+    // get them through a hash (or a shift in register mode), exactly like
+    // the X2 and X3 outputs when all channels share the same clock.
+    hash_[i] = static_cast<uint32_t>(i) * 0x9e3779b9;
+    shift_[i] = 0;
+    level_quantizer_[i].Init();
+    level_[i] = 0;
+    voltage_[i] = 0.0f;
+    quantized_voltage_[i] = 0.0f;
+    ramp_start_[i] = 0.0f;
+    ramp_value_[i] = 0.0f;
+    lp_state_[i] = 0.0f;
+  }
+}
+
+void WideXGenerator::Configure(const GroupSettings& settings) {
+  switch (settings.voltage_range) {
+    case VOLTAGE_RANGE_NARROW:
+      scale_offset_ = ScaleOffset(2.0f, 0.0f);
+      break;
+    
+    case VOLTAGE_RANGE_POSITIVE:
+      scale_offset_ = ScaleOffset(5.0f, 0.0f);
+      break;
+    
+    case VOLTAGE_RANGE_FULL:
+      scale_offset_ = ScaleOffset(10.0f, -5.0f);
+      break;
+    
+    default:
+      break;
+  }
+  
+  scale_index_ = settings.scale_index;
+  register_mode_ = settings.register_mode;
+  register_value_ = settings.register_value;
+  
+  const size_t n = num_channels_;
+  const float position_scale = n > 1 ? 1.0f / float(n - 1) : 0.0f;
+  for (size_t i = 0; i < n; ++i) {
+    // Generalization of the bump and tilt modes to n channels. For n = 3,
+    // this gives the same values as XYGenerator.
+    const float position = 2.0f * static_cast<float>(i) * position_scale;
+    float amount = 1.0f;
+    if (settings.control_mode == CONTROL_MODE_BUMP) {
+      amount = 1.0f - 2.0f * fabsf(position - 1.0f);
+    } else if (settings.control_mode == CONTROL_MODE_TILT) {
+      amount = position - 1.0f;
+    }
+    
+    // In register mode, shifted copies of the register are sent to the
+    // outputs. There are only kHistoryBufferSize past values to pick from.
+    // In bump mode, the channels in the second half are shifted by one step
+    // so that they differ from their mirror image in the first half (for
+    // n = 3, only X3 is shifted, as in XYGenerator).
+    if (settings.control_mode == CONTROL_MODE_IDENTICAL) {
+      shift_[i] = i % kHistoryBufferSize;
+    } else if (settings.control_mode == CONTROL_MODE_BUMP) {
+      shift_[i] = position > 1.0f ? 1 : 0;
+    } else {
+      shift_[i] = 0;
+    }
+    
+    spread_[i] = 0.5f + (settings.spread - 0.5f) * amount;
+    bias_[i] = 0.5f + (settings.bias - 0.5f) * amount;
+    register_transposition_[i] = 4.0f * settings.spread * \
+        (settings.bias - 0.5f) * amount;
+    
+    const float steps = 0.5f + (settings.steps - 0.5f) * \
+        (settings.register_mode ? 1.0f : amount);
+    level_[i] = level_quantizer_[i].Process(
+        2.0f * steps - 1.0f, kNumThresholds + 1);
+    hold_[i] = steps >= 0.5f ? 1.0f : 0.0f;
+    
+    // Precompute everything LagProcessor::Process would derive from the
+    // smoothness parameter.
+    const float smoothness = 1.0f - 2.0f * steps;
+    lag_ratio_[i] = 0.25f * SemitonesToRatio(84.0f * (1.0f - smoothness));
+    lag_boost_[i] = smoothness <= 0.05f ? 20.0f * (0.05f - smoothness) : 0.0f;
+    float interp_amount = (smoothness - 0.6f) * 5.0f;
+    CONSTRAIN(interp_amount, 0.0f, 1.0f);
+    float interp_linearity = (1.0f - smoothness) * 5.0f;
+    CONSTRAIN(interp_linearity, 0.0f, 1.0f);
+    interp_amount_[i] = interp_amount;
+    interp_linearity_[i] = interp_linearity;
+  }
+}
+
+void WideXGenerator::ComputeVoltages(bool reset_ramp) {
+  const size_t n = num_channels_;
+  const float u_0 = sequence_.history(0);
+  float u[kMaxNumWideChannels];
+  
+  if (register_mode_) {
+    for (size_t i = 0; i < n; ++i) {
+      u[i] = sequence_.history(shift_[i]);
+      voltage_[i] = 10.0f * (u[i] - 0.5f) + register_transposition_[i];
+    }
+  } else {
+    const uint32_t word_0 = static_cast<uint32_t>(u_0 * kMaxUint32);
+    for (size_t i = 0; i < n; ++i) {
+      uint32_t word = (word_0 ^ hash_[i]) * 1664525L + 1013904223L;
+      u[i] = hash_[i] ? static_cast<float>(word) / kMaxUint32 : u_0;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      const float spread = spread_[i];
+      const float bias = bias_[i];
+      float degenerate_amount = 1.25f - spread * 25.0f;
+      float bernoulli_amount = spread * 25.0f - 23.75f;
+      CONSTRAIN(degenerate_amount, 0.0f, 1.0f);
+      CONSTRAIN(bernoulli_amount, 0.0f, 1.0f);
+      
+      float value = BetaDistributionSample(u[i], spread, bias);
+      float bernoulli_value = u[i] >= (1.0f - bias) ? 0.999999f : 0.0f;
+      value += degenerate_amount * (bias - value);
+      value += bernoulli_amount * (bernoulli_value - value);
+      voltage_[i] = scale_offset_(value);
+    }
+  }
+  
+  const Quantizer& quantizer = quantizer_[scale_index_];
+  for (size_t i = 0; i < n; ++i) {
+    quantized_voltage_[i] = level_[i] > 0
+        ? quantizer.Quantize(voltage_[i], level_[i] - 1)
+        : voltage_[i];
+  }
+  
+  if (reset_ramp) {
+    copy(&ramp_value_[0], &ramp_value_[n], &ramp_start_[0]);
+  }
+}
+
+void WideXGenerator::Process(
+    const GroupSettings& settings,
+    bool reset,
+    const float* phase,
+    float* output,
+    size_t size) {
+  Configure(settings);
+  sequence_.set_length(settings.length);
+  sequence_.set_deja_vu(settings.deja_vu);
+  if (reset) {
+    sequence_.Reset();
+  }
+  
+  // See OutputChannel::Process for the rationale.
+  if (reacquisition_counter_) {
+    --reacquisition_counter_;
+    sequence_.RewriteValue(register_value_);
+    ComputeVoltages(false);
+  }
+  
+  const size_t n = num_channels_;
+  while (size--) {
+    const float p = *phase++;
+    if (p < previous_phase_) {
+      sequence_.NextValue(register_mode_, register_value_);
+      ComputeVoltages(true);
+      if (register_mode_) {
+        reacquisition_counter_ = kNumReacquisitions;
+      }
+    }
+    
+    float frequency = p - previous_phase_;
+    if (frequency < 0.0f) {
+      frequency += 1.0f;
+    }
+    previous_phase_ = p;
+    
+    const float warped_phase = Interpolate(lut_raised_cosine, p, 256.0f);
+    const float linear_phase = p - warped_phase;
+    
+    for (size_t i = 0; i < n; ++i) {
+      // Same as LagProcessor::Process, with the parameters precomputed in
+      // Configure().
+      float f = frequency * lag_ratio_[i];
+      f = f >= 1.0f ? 1.0f : f;
+      f += lag_boost_[i] * (1.0f - f);
+      
+      const float voltage = voltage_[i];
+      const float lp = lp_state_[i] + f * (voltage - lp_state_[i]);
+      lp_state_[i] = lp;
+      
+      const float interp_phase = warped_phase + \
+          linear_phase * interp_linearity_[i];
+      const float interp = ramp_start_[i] + \
+          (voltage - ramp_start_[i]) * interp_phase;
+      ramp_value_[i] = interp;
+      
+      const float smooth = lp + (interp - lp) * interp_amount_[i];
+      output[i] = smooth + (quantized_voltage_[i] - smooth) * hold_[i];
+    }
+    output += n;
+  }
+}
+
+}  // namespace marbles
@@ -0,0 +1,111 @@
+// Copyright 2015 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Generator for a large number of X outputs sharing the same clock and the
+// same deja-vu memory. The per-channel state is stored as arrays (one entry
+// per channel), and the scale data is shared by all channels, so that adding
+// a channel only adds a few multiply-adds per sample.
+
+#ifndef MARBLES_RANDOM_WIDE_X_GENERATOR_H_
+#define MARBLES_RANDOM_WIDE_X_GENERATOR_H_
+
+#include "stmlib/stmlib.h"
+#include "stmlib/dsp/hysteresis_quantizer.h"
+
+#include "marbles/random/output_channel.h"
+#include "marbles/random/quantizer.h"
+#include "marbles/random/random_sequence.h"
+#include "marbles/random/x_y_generator.h"
+
+namespace marbles {
+
+const size_t kMaxNumWideChannels = 64;
+
+class WideXGenerator {
+ public:
+  WideXGenerator() { }
+  ~WideXGenerator() { }
+  
+  void Init(RandomStream* random_stream, size_t num_channels);
+  
+  // Renders size frames of num_channels interleaved voltages, clocked by
+  // phase (a ramp wrapping around at each clock tick).
+  void Process(
+      const GroupSettings& settings,
+      bool reset,
+      const float* phase,
+      float* output,
+      size_t size);
+  
+  void LoadScale(int scale_index, const Scale& scale) {
+    quantizer_[scale_index].Init(scale);
+  }
+  
+  inline size_t num_channels() const { return num_channels_; }
+  
+ private:
+  void Configure(const GroupSettings& settings);
+  void ComputeVoltages(bool reset_ramp);
+  
+  size_t num_channels_;
+  
+  RandomSequence sequence_;
+  Quantizer quantizer_[kNumScales];
+  
+  // Settings, constant during a block.
+  ScaleOffset scale_offset_;
+  int scale_index_;
+  bool register_mode_;
+  float register_value_;
+  
+  float spread_[kMaxNumWideChannels];
+  float bias_[kMaxNumWideChannels];
+  float register_transposition_[kMaxNumWideChannels];
+  uint32_t hash_[kMaxNumWideChannels];
+  uint32_t shift_[kMaxNumWideChannels];
+  stmlib::HysteresisQuantizer level_quantizer_[kMaxNumWideChannels];
+  int level_[kMaxNumWideChannels];
+  float hold_[kMaxNumWideChannels];
+  float lag_ratio_[kMaxNumWideChannels];
+  float lag_boost_[kMaxNumWideChannels];
+  float interp_amount_[kMaxNumWideChannels];
+  float interp_linearity_[kMaxNumWideChannels];
+  
+  // State.
+  float previous_phase_;
+  uint32_t reacquisition_counter_;
+  float voltage_[kMaxNumWideChannels];
+  float quantized_voltage_[kMaxNumWideChannels];
+  float ramp_start_[kMaxNumWideChannels];
+  float ramp_value_[kMaxNumWideChannels];
+  float lp_state_[kMaxNumWideChannels];
+  
+  DISALLOW_COPY_AND_ASSIGN(WideXGenerator);
+};
+
+}  // namespace marbles
+
+#endif  // MARBLES_RANDOM_WIDE_X_GENERATOR_H_
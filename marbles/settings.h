@@ -47,8 +47,6 @@ struct CalibrationData {
   float dac_scale[DAC_CHANNEL_LAST];
 };
 
-const int kNumScales = 6;
-
 struct PersistentData {
   CalibrationData calibration_data;
   Scale scale[kNumScales];
@@ -23,6 +23,7 @@
 #include "marbles/random/random_sequence.h"
 #include "marbles/random/random_stream.h"
 #include "marbles/random/t_generator.h"
+#include "marbles/random/wide_x_generator.h"
 #include "marbles/random/x_y_generator.h"
 #include "marbles/scale_recorder.h"
 #include "marbles/test/fixtures.h"
@@ -122,6 +123,100 @@ void TestQuantizerNoise() {
   fclose(fp);
 }
 
+// Reference implementation: masked linear search through all the degrees.
+float QuantizeLinear(const Scale& scale, uint8_t threshold, float value) {
+  const float note = value * (1.0f / scale.base_interval);
+  MAKE_INTEGRAL_FRACTIONAL(note);
+  if (value < 0.0f) {
+    note_integral -= 1;
+    note_fractional += 1.0f;
+  }
+  note_fractional *= scale.base_interval;
+  
+  int first = -1;
+  int last = -1;
+  for (int i = 0; i < scale.num_degrees; ++i) {
+    if (scale.degree[i].weight >= threshold) {
+      if (first == -1) first = i;
+      last = i;
+    }
+  }
+  float a = scale.degree[last].voltage - scale.base_interval;
+  float b = scale.degree[first].voltage + scale.base_interval;
+  for (int i = 0; i < scale.num_degrees; ++i) {
+    if (scale.degree[i].weight >= threshold) {
+      float v = scale.degree[i].voltage;
+      if (note_fractional > v) {
+        a = v;
+      } else {
+        b = v;
+        break;
+      }
+    }
+  }
+  float quantized_voltage = note_fractional < (a + b) * 0.5f ? a : b;
+  return quantized_voltage + static_cast<float>(note_integral) * \
+      scale.base_interval;
+}
+
+void TestQuantizerSearch() {
+  // The first 5 levels use fixed thresholds.
+  const uint8_t thresholds[] = { 0, 16, 32, 64, 128 };
+  int errors = 0;
+  int total = 0;
+  for (int trial = 0; trial < 100; ++trial) {
+    Scale scale;
+    if (trial == 0) {
+      scale.InitMajor();
+    } else if (trial == 1) {
+      scale.InitTenth();
+    } else if (trial == 2) {
+      // Degrees closer to each other than the width of a bin.
+      const float voltages[] = { 0.0f, 0.3f, 0.305f, 0.31f, 0.7f };
+      scale.base_interval = 1.0f;
+      scale.num_degrees = 5;
+      for (int i = 0; i < 5; ++i) {
+        scale.degree[i].voltage = voltages[i];
+        scale.degree[i].weight = 255;
+      }
+    } else if (trial < 50) {
+      // 16 degrees packed in a few mV, some of them repeated.
+      scale.base_interval = 1.0f;
+      scale.num_degrees = kMaxDegrees;
+      float v = 0.3f;
+      for (int i = 0; i < kMaxDegrees; ++i) {
+        scale.degree[i].voltage = v;
+        scale.degree[i].weight = i == 0 ? 255 : rand() % 256;
+        v += 0.002f * (rand() % 4);
+      }
+    } else {
+      scale.base_interval = 0.5f + (rand() % 1000) / 1000.0f;
+      scale.num_degrees = 1 + rand() % kMaxDegrees;
+      float v = 0.0f;
+      for (int i = 0; i < scale.num_degrees; ++i) {
+        scale.degree[i].voltage = v;
+        scale.degree[i].weight = i == 0 ? 255 : rand() % 256;
+        v += scale.base_interval / scale.num_degrees * \
+            (0.5f + (rand() % 1000) / 1000.0f);
+        v = std::min(v, scale.base_interval * 0.999f);
+      }
+    }
+    
+    Quantizer q;
+    q.Init(scale);
+    for (int i = 0; i < 10000; ++i) {
+      float value = (rand() % 12000) / 1000.0f - 6.0f;
+      int level = rand() % 5;
+      float expected = QuantizeLinear(scale, thresholds[level], value);
+      if (q.Quantize(value, level) != expected) {
+        ++errors;
+      }
+      ++total;
+    }
+  }
+  printf("Quantizer search: %d / %d errors\n", errors, total);
+}
+
 void TestRampExtractorClockBug() {
   WavWriter wav_writer(2, ::kSampleRate, 20);
   wav_writer.Open("marbles_ramp_extractor_clock_bug.wav");
@@ -561,6 +656,99 @@ void TestXYGenerator() {
   }
 }
 
+void TestWideXGenerator() {
+  const size_t kNumChannels = 5;
+  
+  RandomGenerator random_generator[2];
+  RandomStream random_stream[2];
+  WideXGenerator wide[2];
+  for (int i = 0; i < 2; ++i) {
+    random_generator[i].Init(32);
+    random_stream[i].Init(&random_generator[i]);
+    wide[i].Init(&random_stream[i], i == 0 ? 1 : kNumChannels);
+  }
+  Scale scale;
+  scale.InitMajor();
+  wide[1].LoadScale(2, scale);
+  
+  GroupSettings settings;
+  settings.control_mode = CONTROL_MODE_IDENTICAL;
+  settings.voltage_range = VOLTAGE_RANGE_FULL;
+  settings.register_mode = false;
+  settings.register_value = 0.0f;
+  settings.spread = 0.8f;
+  settings.bias = 0.3f;
+  settings.steps = 0.3f;
+  settings.deja_vu = 0.0f;
+  settings.length = 8;
+  settings.ratio.p = 1;
+  settings.ratio.q = 1;
+  settings.scale_index = 0;
+  
+  // 1. Adding channels doesn't change the first one.
+  // 2. Fully quantized to the major scale, the outputs are on C or G.
+  // 3. In register mode, the channels in the second half of the bump are one
+  // step behind the first half.
+  int channel_0_errors = 0;
+  int scale_errors = 0;
+  int shift_errors = 0;
+  float previous[kNumChannels];
+  fill(&previous[0], &previous[kNumChannels], 0.0f);
+  for (int test = 0; test < 3; ++test) {
+    settings.control_mode = test == 2 ? CONTROL_MODE_BUMP
+        : CONTROL_MODE_IDENTICAL;
+    settings.register_mode = test == 2;
+    settings.steps = test == 0 ? 0.3f : (test == 1 ? 1.0f : 0.5f);
+    settings.scale_index = test == 1 ? 2 : 0;
+    settings.bias = test == 2 ? 0.5f : 0.3f;
+    
+    float phase = 0.0f;
+    for (size_t i = 0; i < kSampleRate * 10; i += kAudioBlockSize) {
+      float ramp[kAudioBlockSize];
+      bool tick = false;
+      for (size_t j = 0; j < kAudioBlockSize; ++j) {
+        phase += 0.0013f;
+        if (phase >= 1.0f) {
+          phase -= 1.0f;
+          tick = true;
+        }
+        ramp[j] = phase;
+      }
+      settings.register_value = 0.5f + 0.4f * sinf(float(i) * 0.0007f);
+      
+      float out[2][kAudioBlockSize * kNumChannels];
+      wide[0].Process(settings, false, ramp, out[0], kAudioBlockSize);
+      wide[1].Process(settings, false, ramp, out[1], kAudioBlockSize);
+      
+      for (size_t j = 0; j < kAudioBlockSize; ++j) {
+        const float* x = &out[1][j * kNumChannels];
+        if (test == 0 && x[0] != out[0][j]) {
+          ++channel_0_errors;
+        }
+        if (test == 1 && i > kSampleRate) {
+          float degree = x[0] * 12.0f - floorf(x[0]) * 12.0f;
+          if (fabsf(degree) > 1e-3f && fabsf(degree - 7.0f) > 1e-3f) {
+            ++scale_errors;
+          }
+        }
+        if (test == 2 && i > kSampleRate) {
+          const bool first_sample = tick && ramp[j] < 0.0013f;
+          for (size_t k = 1; k < kNumChannels; ++k) {
+            if (k <= kNumChannels / 2) {
+              shift_errors += x[k] != x[0];
+            } else if (first_sample) {
+              shift_errors += x[k] != previous[0];
+            }
+          }
+        }
+        copy(&x[0], &x[kNumChannels], &previous[0]);
+      }
+    }
+  }
+  printf("WideXGenerator: %d channel 0 errors, %d scale errors, "
+         "%d shift errors\n", channel_0_errors, scale_errors, shift_errors);
+}
+
 void TestXYGeneratorASR() {
   WavWriter wav_writer(4, ::kSampleRate, 10);
   wav_writer.Open("marbles_xy_asr.wav");
@@ -1129,6 +1317,8 @@ int main(void) {
   
   // TestCVChannel();
 
+  TestQuantizerSearch();
+  TestWideXGenerator();
   TestReset();
   TestClockSourceChange();
 }
@@ -0,0 +1,103 @@
+// Copyright 2017 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// In-process replacement for the serial links between modules, for emulating
+// chains of modules on a host.
+//
+// Each module owns a slot in which it publishes a snapshot of its state at
+// every block, and reads the snapshots of the other modules. A slot is guarded
+// by a sequence counter: odd while the owner is writing, incremented again
+// once the snapshot is complete. Readers never wait - if a snapshot is torn,
+// they keep the previous one. Modules can thus be rendered on different
+// threads, with at most one block of latency between modules.
+
+#ifndef STAGES_CHAIN_BUS_H_
+#define STAGES_CHAIN_BUS_H_
+
+#include "stmlib/stmlib.h"
+
+#include <algorithm>
+
+#include "stages/chain_state.h"
+
+namespace stages {
+
+class ChainBus {
+ public:
+  ChainBus() { }
+  ~ChainBus() { }
+  
+  void Init(size_t size) {
+    size_ = std::min(std::max(size, size_t(1)), kMaxChainSize);
+    for (size_t i = 0; i < kMaxChainSize; ++i) {
+      slot_[i].sequence = 0;
+    }
+  }
+  
+  inline size_t size() const { return size_; }
+  
+ private:
+  friend class ChainState;
+  
+  struct Slot {
+    volatile uint32_t sequence;
+    ChainState::Snapshot snapshot;
+  };
+  
+  // Only called by the owner of the slot.
+  inline void Publish(size_t index, const ChainState::Snapshot& snapshot) {
+    Slot* s = &slot_[index];
+    uint32_t sequence = s->sequence;
+    s->sequence = sequence + 1;
+    __sync_synchronize();
+    s->snapshot = snapshot;
+    __sync_synchronize();
+    s->sequence = sequence + 2;
+  }
+  
+  // Returns false if nothing has been published yet, or if the snapshot has
+  // been modified while we were copying it.
+  inline bool Fetch(size_t index, ChainState::Snapshot* snapshot) const {
+    const Slot* s = &slot_[index];
+    uint32_t sequence = s->sequence;
+    if (sequence == 0 || (sequence & 1)) {
+      return false;
+    }
+    __sync_synchronize();
+    *snapshot = s->snapshot;
+    __sync_synchronize();
+    return s->sequence == sequence;
+  }
+  
+  size_t size_;
+  Slot slot_[kMaxChainSize];
+  
+  DISALLOW_COPY_AND_ASSIGN(ChainBus);
+};
+
+}  // namespace stages
+
+#endif  // STAGES_CHAIN_BUS_H_
@@ -30,7 +30,10 @@
 
 #include <algorithm>
 
+#include "stages/chain_bus.h"
+#ifndef TEST
 #include "stages/drivers/serial_link.h"
+#endif  // TEST
 #include "stages/settings.h"
 
 namespace stages {
@@ -40,40 +43,34 @@ using namespace std;
 const uint32_t kLeftKey = stmlib::FourCC<'d', 'i', 's', 'c'>::value;
 const uint32_t kRightKey = stmlib::FourCC<'o', 'v', 'e', 'r'>::value;
 
-// How long before unpatching an input actually breaks the chain.
+// How long before unpatching an input actually breaks the chain. The serial
+// protocol updates the local state once every 4 blocks, the bus at every block.
 const uint32_t kUnpatchedInputDelay = 2000;
+const uint32_t kBusUnpatchedInputDelay = kUnpatchedInputDelay * 4;
 const int32_t kLongPressDuration = 800;
 const int32_t kVeryLongPressDuration = 3000;
 
-void ChainState::Init(SerialLink* left, SerialLink* right) {
+void ChainState::Reset() {
   index_ = 0;
   size_ = 1;
   
-  left_ = left;
-  right_ = right;
-  
-  STATIC_ASSERT(sizeof(Packet) == kPacketSize, BAD_PACKET_SIZE);
-  
-  left_->Init(
-      SERIAL_LINK_DIRECTION_LEFT,
-      115200 * 8,
-      left_rx_packet_[0].bytes,
-      kPacketSize);
-  right_->Init(
-      SERIAL_LINK_DIRECTION_RIGHT,
-      115200 * 8,
-      right_rx_packet_[0].bytes,
-      kPacketSize);
+  left_ = NULL;
+  right_ = NULL;
+  bus_ = NULL;
   
   ChannelState c = { .flags = 0xf0, .pot = 128, .cv_slider = 32768 };
 
   fill(&channel_state_[0], &channel_state_[kMaxNumChannels], c);
+  fill(&dirty_[0], &dirty_[kMaxNumChannels], false);
   fill(&unpatch_counter_[0], &unpatch_counter_[kNumChannels], 0);
   fill(&loop_status_[0], &loop_status_[kNumChannels], LOOP_STATUS_NONE);
   fill(&switch_pressed_[0], &switch_pressed_[kMaxChainSize], 0);
+  fill(&input_patched_[0], &input_patched_[kMaxChainSize], 0);
   fill(&switch_press_time_[0], &switch_press_time_[kMaxNumChannels], 0);
   
   request_.request = REQUEST_NONE;
+  request_counter_ = 0;
+  unpatched_input_delay_ = kUnpatchedInputDelay;
   
   discovering_neighbors_ = true;
   ouroboros_ = false;
@@ -82,6 +79,48 @@ void ChainState::Init(SerialLink* left, SerialLink* right) {
   num_bindings_ = 0;
 }
 
+void ChainState::Init(ChainBus* bus, size_t index) {
+  Reset();
+  
+  bus_ = bus;
+  size_ = bus->size();
+  index_ = std::min(index, size_ - 1);
+  unpatched_input_delay_ = kBusUnpatchedInputDelay;
+  discovering_neighbors_ = false;
+  
+  rx_last_patched_channel_ = size_ * kNumChannels;
+  rx_last_loop_.start = -1;
+  rx_last_loop_.end = -1;
+  rx_last_sample_.value = 0.0f;
+  rx_last_sample_.phase = 0.0f;
+  rx_last_sample_.segment = 0;
+  tx_last_patched_channel_ = rx_last_patched_channel_;
+  tx_last_loop_ = rx_last_loop_;
+  tx_last_sample_ = rx_last_sample_;
+}
+
+#ifndef TEST
+
+void ChainState::Init(SerialLink* left, SerialLink* right) {
+  Reset();
+  
+  left_ = left;
+  right_ = right;
+  
+  STATIC_ASSERT(sizeof(Packet) == kPacketSize, BAD_PACKET_SIZE);
+  
+  left_->Init(
+      SERIAL_LINK_DIRECTION_LEFT,
+      115200 * 8,
+      left_rx_packet_[0].bytes,
+      kPacketSize);
+  right_->Init(
+      SERIAL_LINK_DIRECTION_RIGHT,
+      115200 * 8,
+      right_rx_packet_[0].bytes,
+      kPacketSize);
+}
+
 void ChainState::DiscoverNeighbors() {
   // Between t = 500ms and t = 1500ms, ping the neighbors every 50ms
   if (counter_ >= 2000 &&
@@ -107,7 +146,7 @@ void ChainState::DiscoverNeighbors() {
     size_ = std::max(size_, size_t(r->counter));
   }
   
-  ouroboros_ = index_ >= kMaxChainSize || size_ > kMaxChainSize;
+  ouroboros_ = index_ >= kMaxSerialChainSize || size_ > kMaxSerialChainSize;
 
   // The discovery phase lasts 2000ms.
   discovering_neighbors_ = counter_ < 8000 && !ouroboros_;
@@ -228,6 +267,53 @@ void ChainState::ReceiveLeft() {
   }
 }
 
+#endif  // TEST
+
+void ChainState::PublishSnapshot() {
+  Snapshot s;
+  copy(local_channel(0), local_channel(kNumChannels), &s.channel[0]);
+  s.switch_pressed = switch_pressed_[index_];
+  s.input_patched = input_patched_[index_];
+  s.last_patched_channel = tx_last_patched_channel_;
+  s.last_loop = tx_last_loop_;
+  s.last_sample = tx_last_sample_;
+  s.request = request_;
+  s.request_counter = request_counter_;
+  bus_->Publish(index_, s);
+}
+
+void ChainState::ReceiveSnapshots() {
+  Snapshot s;
+  for (size_t i = 0; i < size_; ++i) {
+    if (i == index_ || !bus_->Fetch(i, &s)) {
+      continue;
+    }
+    switch_pressed_[i] = s.switch_pressed;
+    input_patched_[i] = s.input_patched;
+    
+    if (i == index_ - 1) {
+      rx_last_patched_channel_ = s.last_patched_channel;
+      rx_last_loop_ = s.last_loop;
+      rx_last_sample_ = s.last_sample;
+    } else if (i > index_) {
+      // Only the state of the modules on the right matters to build the
+      // chains of segments starting in this module.
+      for (size_t j = 0; j < kNumChannels; ++j) {
+        dirty_[remote_channel_index(i, j)] = \
+            remote_channel(i, j)->flags != s.channel[j].flags;
+      }
+      copy(&s.channel[0], &s.channel[kNumChannels], remote_channel(i, 0));
+    }
+    
+    // Requests are issued by the last module. Since we might see the same
+    // snapshot several times (or miss some), they are numbered.
+    if (i == size_ - 1 && s.request_counter != request_counter_) {
+      request_counter_ = s.request_counter;
+      request_ = s.request;
+    }
+  }
+}
+
 void ChainState::Configure(SegmentGenerator* segment_generator) {
   size_t last_local_channel = local_channel_index(0) + kNumChannels;
   size_t last_channel = size_ * kNumChannels;
@@ -243,7 +329,8 @@ void ChainState::Configure(SegmentGenerator* segment_generator) {
     size_t channel = local_channel_index(i);
     
     if (!local_channel(i)->input_patched()) {
-      if (channel > last_patched_channel) {
+      if (channel > last_patched_channel &&
+          channel - last_patched_channel < size_t(kMaxNumSegments)) {
         // Create a slave channel - we are just extending a chain of segments.
         size_t segment = channel - last_patched_channel;
         segment_generator[i].ConfigureSlave(segment);
@@ -296,6 +383,7 @@ void ChainState::Configure(SegmentGenerator* segment_generator) {
         ++num_segments;
         
         add_more_segments = channel < last_channel && \
+             num_segments < kMaxNumSegments && \
              !channel_state_[channel].input_patched();
       }
       if (dirty || num_segments != segment_generator[i].num_segments()) {
@@ -326,11 +414,11 @@ inline void ChainState::UpdateLocalState(
   for (size_t i = 0; i < kNumChannels; ++i) {
     if (block.input_patched[i]) {
       unpatch_counter_[i] = 0;
-    } else if (unpatch_counter_[i] < kUnpatchedInputDelay) {
+    } else if (unpatch_counter_[i] < unpatched_input_delay_) {
       ++unpatch_counter_[i];
     }
     
-    bool input_patched = unpatch_counter_[i] < kUnpatchedInputDelay;
+    bool input_patched = unpatch_counter_[i] < unpatched_input_delay_;
     dirty_[local_channel_index(i)] = local_channel(i)->UpdateFlags(
         index_,
         settings.state().segment_configuration[i],
@@ -568,30 +656,51 @@ void ChainState::Update(
     Settings* settings,
     SegmentGenerator* segment_generator,
     SegmentGenerator::Output* out) {
-  if (discovering_neighbors_) {
-    DiscoverNeighbors();
-    return;
-  }
-  
-  switch (counter_ & 0x3) {
-    case 0:
+  if (bus_) {
+    // Switches are still polled at 1kHz, so that the press durations do not
+    // depend on the transport.
+    request_.request = REQUEST_NONE;
+    if ((counter_ & 0x3) == 0) {
       PollSwitches();
-      UpdateLocalState(block, *settings, out[kBlockSize - 1]);
-      TransmitRight();
-      break;
-    case 1:
-      ReceiveRight();
-      HandleRequest(settings);
-      break;
-    case 2:
-      UpdateLocalPotCvSlider(block);
-      TransmitLeft();
-      break;
-    case 3:
-      ReceiveLeft();
-      Configure(segment_generator);
-      BindRemoteParameters(segment_generator);
-      break;
+      if (request_.request != REQUEST_NONE) {
+        ++request_counter_;
+      }
+    }
+    UpdateLocalState(block, *settings, out[kBlockSize - 1]);
+    UpdateLocalPotCvSlider(block);
+    PublishSnapshot();
+    ReceiveSnapshots();
+    HandleRequest(settings);
+    Configure(segment_generator);
+    BindRemoteParameters(segment_generator);
+  } else {
+#ifndef TEST
+    if (discovering_neighbors_) {
+      DiscoverNeighbors();
+      return;
+    }
+    
+    switch (counter_ & 0x3) {
+      case 0:
+        PollSwitches();
+        UpdateLocalState(block, *settings, out[kBlockSize - 1]);
+        TransmitRight();
+        break;
+      case 1:
+        ReceiveRight();
+        HandleRequest(settings);
+        break;
+      case 2:
+        UpdateLocalPotCvSlider(block);
+        TransmitLeft();
+        break;
+      case 3:
+        ReceiveLeft();
+        Configure(segment_generator);
+        BindRemoteParameters(segment_generator);
+        break;
+    }
+#endif  // TEST
   }
   
   BindLocalParameters(block, segment_generator);
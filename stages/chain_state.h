@@ -36,10 +36,21 @@
 
 namespace stages {
 
-const size_t kMaxChainSize = 6;
+// The serial protocol packs the state of the chain in fixed-size packets and
+// identifies modules with a 4-bit index, so hardware chains are limited to 6
+// modules. Virtual chains sharing a ChainBus are only limited by the size of
+// the state tables, which a host can raise up to 42 modules (because of the
+// 8-bit channel indices in request packets).
+#ifndef STAGES_MAX_CHAIN_SIZE
+#define STAGES_MAX_CHAIN_SIZE 6
+#endif  // STAGES_MAX_CHAIN_SIZE
+
+const size_t kMaxSerialChainSize = 6;
+const size_t kMaxChainSize = STAGES_MAX_CHAIN_SIZE;
 const size_t kMaxNumChannels = kMaxChainSize * kNumChannels;
 const size_t kPacketSize = 24;
 
+class ChainBus;
 class SerialLink;
 class Settings;
 
@@ -51,6 +62,11 @@ class ChainState {
   typedef uint8_t ChannelBitmask;
   
   void Init(SerialLink* left, SerialLink* right);
+  
+  // Joins a virtual chain as the index-th module. There is no discovery
+  // phase: the size of the chain is the size of the bus.
+  void Init(ChainBus* bus, size_t index);
+  
   void Update(
       const IOBuffer::Block& block,
       Settings* settings,
@@ -85,6 +101,9 @@ class ChainState {
   }
   
  private:
+  friend class ChainBus;
+  
+  void Reset();
   void DiscoverNeighbors();
 
   void TransmitRight();
@@ -92,6 +111,9 @@ class ChainState {
   void ReceiveRight();
   void ReceiveLeft();
   
+  void PublishSnapshot();
+  void ReceiveSnapshots();
+  
   void UpdateLocalState(
       const IOBuffer::Block& block,
       const Settings& settings,
@@ -156,8 +178,8 @@ class ChainState {
     int8_t segment;
     float phase;
     Loop last_loop;
-    ChannelBitmask switch_pressed[kMaxChainSize];
-    ChannelBitmask input_patched[kMaxChainSize];
+    ChannelBitmask switch_pressed[kMaxSerialChainSize];
+    ChannelBitmask input_patched[kMaxSerialChainSize];
   };
   
   struct RightToLeftPacket {
@@ -189,6 +211,20 @@ class ChainState {
     uint8_t bytes[kPacketSize];
   };
   
+  // What a module shares with the other modules of a virtual chain at every
+  // block. This is the union of what the serial protocol spreads over several
+  // packets and several blocks.
+  struct Snapshot {
+    ChannelState channel[kNumChannels];
+    ChannelBitmask switch_pressed;
+    ChannelBitmask input_patched;
+    size_t last_patched_channel;
+    Loop last_loop;
+    SegmentGenerator::Output last_sample;
+    RequestPacket request;
+    uint32_t request_counter;
+  };
+  
   struct ParameterBinding {
     size_t generator;
     size_t source;
@@ -229,6 +265,7 @@ class ChainState {
   
   SerialLink* left_;
   SerialLink* right_;
+  ChainBus* bus_;
   
   ChannelState channel_state_[kMaxNumChannels];
   bool dirty_[kMaxNumChannels];
@@ -248,6 +285,8 @@ class ChainState {
   SegmentGenerator::Output tx_last_sample_;
 
   RequestPacket request_;
+  uint32_t request_counter_;
+  uint16_t unpatched_input_delay_;
   
   bool discovering_neighbors_;
   bool ouroboros_;
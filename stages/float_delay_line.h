@@ -0,0 +1,125 @@
+// Copyright 2017 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Float delay line with a runtime-sized, externally allocated power-of-two
+// buffer, and block read/write. Meant for long, lossless CV delays on hosts
+// which have the memory for it.
+//
+// Read(1.0f) returns the last written sample. Block reads return the same
+// samples as interleaved Write/Read calls would, but must be done *before*
+// writing the block, and the delay must then be longer than the block.
+
+#ifndef STAGES_FLOAT_DELAY_LINE_H_
+#define STAGES_FLOAT_DELAY_LINE_H_
+
+#include "stmlib/stmlib.h"
+#include "stmlib/dsp/dsp.h"
+
+#include <algorithm>
+
+namespace stages {
+
+class FloatDelayLine {
+ public:
+  FloatDelayLine() { }
+  ~FloatDelayLine() { }
+  
+  // size must be a power of two. A NULL buffer, or a size which is not a
+  // power of two, disables the delay line.
+  void Init(float* buffer, size_t size) {
+    const bool valid = buffer && size && !(size & (size - 1));
+    line_ = valid ? buffer : NULL;
+    size_ = valid ? size : 0;
+    mask_ = size_ ? size_ - 1 : 0;
+    Reset();
+  }
+  
+  void Reset() {
+    if (line_) {
+      std::fill(&line_[0], &line_[size_], 0.0f);
+    }
+    write_ptr_ = 0;
+  }
+  
+  inline size_t size() const { return size_; }
+  
+  inline void Write(const float sample) {
+    line_[write_ptr_] = sample;
+    write_ptr_ = (write_ptr_ + 1) & mask_;
+  }
+  
+  inline float Read(float delay) const {
+    MAKE_INTEGRAL_FRACTIONAL(delay)
+    size_t read_ptr = write_ptr_ - delay_integral;
+    float a = line_[read_ptr & mask_];
+    float b = line_[(read_ptr - 1) & mask_];
+    return a + (b - a) * delay_fractional;
+  }
+  
+  void Write(const float* in, size_t size) {
+    while (size) {
+      size_t chunk = std::min(size, size_ - write_ptr_);
+      std::copy(&in[0], &in[chunk], &line_[write_ptr_]);
+      write_ptr_ = (write_ptr_ + chunk) & mask_;
+      in += chunk;
+      size -= chunk;
+    }
+  }
+  
+  void Read(float delay, float* out, size_t size) const {
+    MAKE_INTEGRAL_FRACTIONAL(delay)
+    size_t read_ptr = (write_ptr_ + 1 - delay_integral) & mask_;
+    if (delay_fractional == 0.0f) {
+      while (size) {
+        size_t chunk = std::min(size, size_ - read_ptr);
+        std::copy(&line_[read_ptr], &line_[read_ptr + chunk], out);
+        read_ptr = (read_ptr + chunk) & mask_;
+        out += chunk;
+        size -= chunk;
+      }
+    } else {
+      float b = line_[(read_ptr - 1) & mask_];
+      for (size_t i = 0; i < size; ++i) {
+        const float a = line_[read_ptr];
+        out[i] = a + (b - a) * delay_fractional;
+        b = a;
+        read_ptr = (read_ptr + 1) & mask_;
+      }
+    }
+  }
+
+ private:
+  float* line_;
+  size_t size_;
+  size_t mask_;
+  size_t write_ptr_;
+  
+  DISALLOW_COPY_AND_ASSIGN(FloatDelayLine);
+};
+
+}  // namespace stages
+
+#endif  // STAGES_FLOAT_DELAY_LINE_H_
@@ -95,8 +95,11 @@ void SegmentGenerator::Init(stmlib::HysteresisQuantizer2* step_quantizer) {
   ramp_extractor_.Init(
       kSampleRate,
       1000.0f / kSampleRate);
+  ramp_follower_.Init(kSampleRate);
+  clock_source_ = NULL;
 
   delay_line_.Init();
+  float_delay_line_.Init(NULL, 0);
   gate_delay_.Init();
   
   function_quantizer_.Init(2, 0.025f, false);
@@ -112,34 +115,12 @@ void SegmentGenerator::Init(stmlib::HysteresisQuantizer2* step_quantizer) {
   accepted_gate_ = true;
   step_quantizer_ = step_quantizer;
   
+  warp_.Init();
+  lfo_shape_.Init();
+  
   audio_osc_.Init();
 }
 
-inline float SegmentGenerator::WarpPhase(float t, float curve) const {
-  curve -= 0.5f;
-  const bool flip = curve < 0.0f;
-  if (flip) {
-    t = 1.0f - t;
-  }
-  const float a = 128.0f * curve * curve;
-  t = (1.0f + a) * t / (1.0f + a * t);
-  if (flip) {
-    t = 1.0f - t;
-  }
-  return t;
-}
-
-inline float SegmentGenerator::RateToFrequency(float rate) const {
-  int32_t i = static_cast<int32_t>(rate * 2048.0f);
-  CONSTRAIN(i, 0, LUT_ENV_FREQUENCY_SIZE);
-  return lut_env_frequency[i];
-}
-
-inline float SegmentGenerator::PortamentoRateToLPCoefficient(float rate) const {
-  int32_t i = static_cast<int32_t>(rate * 512.0f);
-  return lut_portamento_coefficient[i];
-}
-
 // Seems popular enough :)
 #define TRACK_PREVIOUS_SEGMENT
 
@@ -171,10 +152,11 @@ void SegmentGenerator::ProcessMultiSegment(
     if (complete) {
       phase = 1.0f;
     }
+    warp_.set_curve(*segment.curve);
     value = Crossfade(
         start,
         *segment.end,
-        WarpPhase(segment.phase ? *segment.phase : phase, *segment.curve));
+        warp_.Warp(segment.phase ? *segment.phase : phase));
   
     ONE_POLE(lp, value, PortamentoRateToLPCoefficient(*segment.portamento));
   
@@ -215,24 +197,32 @@ void SegmentGenerator::ProcessMultiSegment(
 void SegmentGenerator::ProcessDecayEnvelope(
     const GateFlags* gate_flags, SegmentGenerator::Output* out, size_t size) {
   const float frequency = RateToFrequency(parameters_[0].primary);
-  while (size--) {
-    if (*gate_flags & GATE_FLAG_RISING) {
-      phase_ = 0.0f;
-      active_segment_ = 0;
+  warp_.set_curve(parameters_[0].secondary);
+  
+  float phase = phase_;
+  int active_segment = active_segment_;
+  for (size_t i = 0; i < size; ++i) {
+    if (gate_flags[i] & GATE_FLAG_RISING) {
+      phase = 0.0f;
+      active_segment = 0;
     }
   
-    phase_ += frequency;
-    if (phase_ >= 1.0f) {
-      phase_ = 1.0f;
-      active_segment_ = 1;
+    phase += frequency;
+    if (phase >= 1.0f) {
+      phase = 1.0f;
+      active_segment = 1;
     }
-    lp_ = value_ = 1.0f - WarpPhase(phase_, parameters_[0].secondary);
-    out->value = lp_;
-    out->phase = phase_;
-    out->segment = active_segment_;
-    ++gate_flags;
-    ++out;
+    out[i].phase = phase;
+    out[i].segment = active_segment;
   }
+  phase_ = phase;
+  active_segment_ = active_segment;
+  
+  // The curve is constant during the block: warp all samples in one pass.
+  for (size_t i = 0; i < size; ++i) {
+    out[i].value = 1.0f - warp_.Warp(out[i].phase);
+  }
+  lp_ = value_ = out[size - 1].value;
 }
 
 void SegmentGenerator::ProcessTimedPulseGenerator(
@@ -386,8 +376,9 @@ void SegmentGenerator::ProcessOscillator(
     r = function_quantizer_.Lookup(
         divider_ratios,
         parameters_[0].primary * 1.03f);
-    frequency = ramp_extractor_.Process(
-        audio_rate, false, r, gate_flags, ramp, size);
+    frequency = clock_source_ && !audio_rate
+        ? ramp_follower_.Process(*clock_source_, r, ramp, size)
+        : ramp_extractor_.Process(audio_rate, false, r, gate_flags, ramp, size);
   } else {
     float f = 96.0f * (parameters_[0].primary - 0.5f);
     CONSTRAIN(f, -128.0f, 127.0f);
@@ -433,33 +424,26 @@ void SegmentGenerator::ProcessOscillator(
         ramp[i] = phase_;
       }
     }
-    ShapeLFO(parameters_[0].secondary, ramp, out, size);
+    ShapeLFO(ramp, out, size);
   }
   active_segment_ = out[size - 1].segment;
 }
   
-void SegmentGenerator::ProcessDelay(
-    const GateFlags* gate_flags, SegmentGenerator::Output* out, size_t size) {
-  const float max_delay = static_cast<float>(kMaxDelay - 1);
-  
-  float delay_time = SemitonesToRatio(
-      2.0f * (parameters_[0].secondary - 0.5f) * 36.0f) * 0.5f * kSampleRate;
-  float clock_frequency = 1.0f;
-  float delay_frequency = 1.0f / delay_time;
-  
-  if (delay_time >= max_delay) {
-    clock_frequency = max_delay * delay_frequency;
-    delay_time = max_delay;
-  }
-  ParameterInterpolator primary(&primary_, parameters_[0].primary, size);
-  
-  active_segment_ = 0;
+template<typename DelayLine>
+void SegmentGenerator::RenderDelay(
+    DelayLine* delay_line,
+    float delay_time,
+    float clock_frequency,
+    float delay_frequency,
+    const float* input,
+    SegmentGenerator::Output* out,
+    size_t size) {
   while (size--) {
     phase_ += clock_frequency;
-    ONE_POLE(lp_, primary.Next(), clock_frequency);
+    ONE_POLE(lp_, *input++, clock_frequency);
     if (phase_ >= 1.0f) {
       phase_ -= 1.0f;
-      delay_line_.Write(lp_);
+      delay_line->Write(lp_);
     }
     
     aux_ += delay_frequency;
@@ -470,7 +454,7 @@ void SegmentGenerator::ProcessDelay(
     
     ONE_POLE(
         value_,
-        delay_line_.Read(delay_time - phase_),
+        delay_line->Read(delay_time - phase_),
         clock_frequency);
     out->value = value_;
     out->phase = aux_;
@@ -479,6 +463,70 @@ void SegmentGenerator::ProcessDelay(
   }
 }
 
+void SegmentGenerator::ProcessDelay(
+    const GateFlags* gate_flags, SegmentGenerator::Output* out, size_t size) {
+  const bool float_delay_line = float_delay_line_.size() != 0;
+  const float max_delay = static_cast<float>(
+      (float_delay_line ? float_delay_line_.size() : kMaxDelay) - 1);
+  
+  float delay_time = SemitonesToRatio(
+      2.0f * (parameters_[0].secondary - 0.5f) * 36.0f) * 0.5f * kSampleRate;
+  float clock_frequency = 1.0f;
+  float delay_frequency = 1.0f / delay_time;
+  
+  if (delay_time >= max_delay) {
+    clock_frequency = max_delay * delay_frequency;
+    delay_time = max_delay;
+  }
+  
+  float input[size];
+  ParameterInterpolator primary(&primary_, parameters_[0].primary, size);
+  for (size_t i = 0; i < size; ++i) {
+    input[i] = primary.Next();
+  }
+  
+  active_segment_ = 0;
+  if (!float_delay_line) {
+    RenderDelay(
+        &delay_line_,
+        delay_time,
+        clock_frequency,
+        delay_frequency,
+        input,
+        out,
+        size);
+  } else if (clock_frequency != 1.0f || delay_time - phase_ <= float(size)) {
+    RenderDelay(
+        &float_delay_line_,
+        delay_time,
+        clock_frequency,
+        delay_frequency,
+        input,
+        out,
+        size);
+  } else {
+    // The line runs at the sample rate, with a delay longer than the block:
+    // no smoothing is needed, and the whole block can be read then written
+    // in one go.
+    float delayed[size];
+    float_delay_line_.Read(delay_time - phase_, delayed, size);
+    float_delay_line_.Write(input, size);
+    lp_ = input[size - 1];
+    
+    for (size_t i = 0; i < size; ++i) {
+      aux_ += delay_frequency;
+      if (aux_ >= 1.0f) {
+        aux_ -= 1.0f;
+      }
+      value_ = delayed[i];
+      out[i].value = value_;
+      out[i].phase = aux_;
+      out[i].segment = aux_ < 0.5f ? 0 : 1;
+    }
+    active_segment_ = out[size - 1].segment;
+  }
+}
+
 void SegmentGenerator::ProcessPortamento(
     const GateFlags* gate_flags, SegmentGenerator::Output* out, size_t size) {
   const float coefficient = PortamentoRateToLPCoefficient(
@@ -517,43 +565,41 @@ void SegmentGenerator::ProcessSlave(
   }
 }
 
-/* static */
 void SegmentGenerator::ShapeLFO(
-    float shape,
     const float* input_phase,
     SegmentGenerator::Output* out,
     size_t size) {
-  shape -= 0.5f;
-  shape = 2.0f + 9.999999f * shape / (1.0f + 3.0f * fabs(shape));
+  lfo_shape_.set_shape(parameters_[0].secondary);
+  const segment::LFOShape& s = lfo_shape_;
+  
+  float phase[size];
+  for (size_t i = 0; i < size; ++i) {
+    float p = input_phase[i] + s.phase_shift;
+    phase[i] = p > 1.0f ? p - 1.0f : p;
+    out[i].phase = input_phase[i];
+    out[i].segment = phase[i] < 0.5f ? 0 : 1;
+  }
   
-  const float slope = min(shape * 0.5f, 0.5f);
-  const float plateau_width = max(shape - 3.0f, 0.0f);
-  const float sine_amount = max(
-      shape < 2.0f ? shape - 1.0f : 3.0f - shape, 0.0f);
+  // The triangle is the lowest of the rising and falling lines. Written this
+  // way, a null slope (infinite slope_up) still yields the falling line.
+  for (size_t i = 0; i < size; ++i) {
+    const float up = s.slope_up * phase[i];
+    const float down = 1.0f - (phase[i] - s.slope) * s.slope_down;
+    float triangle = (up < down ? up : down) - 0.5f;
+    CONSTRAIN(triangle, -s.plateau, s.plateau);
+    out[i].value = triangle * s.normalization;
+  }
   
-  const float slope_up = 1.0f / slope;
-  const float slope_down = 1.0f / (1.0f - slope);
-  const float plateau = 0.5f * (1.0f - plateau_width);
-  const float normalization = 1.0f / plateau;
-  const float phase_shift = plateau_width * 0.25f;
+  // The sine is only blended in for a narrow range of shapes.
+  if (s.sine_amount > 0.0f) {
+    for (size_t i = 0; i < size; ++i) {
+      float sine = InterpolateWrap(lut_sine, phase[i] + 0.75f, 1024.0f);
+      out[i].value = Crossfade(out[i].value, sine, s.sine_amount);
+    }
+  }
   
-  while (size--) {
-    float phase = *input_phase + phase_shift;
-    if (phase > 1.0f) {
-      phase -= 1.0f;
-    }
-    float triangle = phase < slope
-        ? slope_up * phase
-        : 1.0f - (phase - slope) * slope_down;
-    triangle -= 0.5f;
-    CONSTRAIN(triangle, -plateau, plateau);
-    triangle = triangle * normalization;
-    float sine = InterpolateWrap(lut_sine, phase + 0.75f, 1024.0f);
-    out->phase = *input_phase;
-    out->value = 0.5f * Crossfade(triangle, sine, sine_amount) + 0.5f;
-    out->segment = phase < 0.5f ? 0 : 1;
-    ++out;
-    ++input_phase;
+  for (size_t i = 0; i < size; ++i) {
+    out[i].value = 0.5f * out[i].value + 0.5f;
   }
 }
 
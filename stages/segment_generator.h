@@ -34,10 +34,16 @@
 #include "stmlib/utils/gate_flags.h"
 
 #include "tides2/ramp/ramp_extractor.h"
+#include "tides2/ramp/shared_ramp_extractor.h"
 #include "stages/delay_line_16_bits.h"
+#include "stages/float_delay_line.h"
+#include "stages/resources.h"
 
 #include "stages/variable_shape_oscillator.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace stages {
 
 const float kSampleRate = 31250.0f;
@@ -78,6 +84,74 @@ struct Parameters {
   float secondary;
 };
 
+// Curve applied to the phase of a segment. The curve parameter is converted
+// only when it changes, and the warping itself is branch-free.
+struct PhaseWarp {
+  float curve;
+  float amount;
+  float flip;
+  
+  inline void Init() {
+    curve = 0.5f;
+    amount = 0.0f;
+    flip = 0.0f;
+  }
+  
+  inline void set_curve(float c) {
+    if (c == curve) {
+      return;
+    }
+    curve = c;
+    c -= 0.5f;
+    amount = 128.0f * c * c;
+    flip = c < 0.0f ? 1.0f : 0.0f;
+  }
+  
+  inline float Warp(float t) const {
+    const float sign = 1.0f - 2.0f * flip;
+    t = flip + sign * t;
+    t = (1.0f + amount) * t / (1.0f + amount * t);
+    return flip + sign * t;
+  }
+};
+
+// Coefficients of the LFO waveshaper (triangle with a variable slope and
+// plateau, crossfaded with a sine), refreshed only when the shape changes.
+struct LFOShape {
+  float shape;
+  float slope;
+  float slope_up;
+  float slope_down;
+  float plateau;
+  float normalization;
+  float phase_shift;
+  float sine_amount;
+  
+  inline void Init() {
+    shape = -1.0f;
+    set_shape(0.5f);
+  }
+  
+  inline void set_shape(float s) {
+    if (s == shape) {
+      return;
+    }
+    shape = s;
+    s -= 0.5f;
+    s = 2.0f + 9.999999f * s / (1.0f + 3.0f * fabsf(s));
+    
+    slope = std::min(s * 0.5f, 0.5f);
+    const float plateau_width = std::max(s - 3.0f, 0.0f);
+    sine_amount = std::max(s < 2.0f ? s - 1.0f : 3.0f - s, 0.0f);
+    
+    slope_up = 1.0f / slope;
+    slope_down = 1.0f / (1.0f - slope);
+    plateau = 0.5f * (1.0f - plateau_width);
+    normalization = 1.0f / plateau;
+    phase_shift = plateau_width * 0.25f;
+  }
+};
+
 }  // namespace segment
 
 class SegmentGenerator {
@@ -146,6 +220,25 @@ class SegmentGenerator {
     num_segments_ = 0;
   }
 
+  // Makes the delay segment use a float delay line running at the full sample
+  // rate for as long as the buffer allows, rather than the 16-bit, 576
+  // samples line clocked down for delays longer than 18ms. size must be a power
+  // of two. Passing a NULL buffer reverts to the 16-bit line. To be called
+  // after Init().
+  void set_delay_line_buffer(float* buffer, size_t size) {
+    float_delay_line_.Init(buffer, size);
+  }
+  
+  // Makes the clocked LFO follow a clock analyzed once for several
+  // generators, instead of running its own RampExtractor on the gate input.
+  // The source must have processed the current block. The audio rate
+  // oscillator keeps its own extractor, since its PLL depends on the ratio.
+  // NULL reverts to the generator's own extractor.
+  void set_clock_source(const tides::SharedRampExtractor* source) {
+    clock_source_ = source;
+    ramp_follower_.Reset();
+  }
+  
   void set_segment_parameters(int index, float primary, float secondary) {
     // assert (primary >= -1.0f && primary <= 2.0f)
     // assert (secondary >= 0.0f && secondary <= 1.0f)
@@ -178,9 +271,18 @@ class SegmentGenerator {
   void ProcessOscillator(bool audio_rate, const stmlib::GateFlags* gate_flags,
       Output* out,size_t size);
   
+  template<typename DelayLine>
+  void RenderDelay(
+      DelayLine* delay_line,
+      float delay_time,
+      float clock_frequency,
+      float delay_frequency,
+      const float* input,
+      Output* out,
+      size_t size);
+  
   
-  static void ShapeLFO(float shape, const float* phase, Output* out, size_t size);
-  float WarpPhase(float t, float curve) const;
+  void ShapeLFO(const float* phase, Output* out, size_t size);
   float RateToFrequency(float rate) const;
   float PortamentoRateToLPCoefficient(float rate) const;
   
@@ -206,13 +308,19 @@ class SegmentGenerator {
   
   ProcessFn process_fn_;
   
+  segment::PhaseWarp warp_;
+  segment::LFOShape lfo_shape_;
+  
   tides::RampExtractor ramp_extractor_;
+  tides::RampFollower ramp_follower_;
+  const tides::SharedRampExtractor* clock_source_;
   stmlib::HysteresisQuantizer2 function_quantizer_;
   
   Segment segments_[kMaxNumSegments + 1];  // There's a sentinel!
   segment::Parameters parameters_[kMaxNumSegments];
   
   DelayLine16Bits<kMaxDelay> delay_line_;
+  FloatDelayLine float_delay_line_;
   stmlib::DelayLine<stmlib::GateFlags, 128> gate_delay_;
   
   enum Direction {
@@ -241,9 +349,22 @@ class SegmentGenerator {
   
   VariableShapeOscillator audio_osc_;
   
+  friend class SegmentGeneratorBank;
+  
   DISALLOW_COPY_AND_ASSIGN(SegmentGenerator);
 };
 
+inline float SegmentGenerator::RateToFrequency(float rate) const {
+  int32_t i = static_cast<int32_t>(rate * 2048.0f);
+  CONSTRAIN(i, 0, LUT_ENV_FREQUENCY_SIZE);
+  return lut_env_frequency[i];
+}
+
+inline float SegmentGenerator::PortamentoRateToLPCoefficient(float rate) const {
+  int32_t i = static_cast<int32_t>(rate * 512.0f);
+  return lut_portamento_coefficient[i];
+}
+
 }  // namespace stages
 
 #endif  // STAGES_SEGMENT_GENERATOR_H_
@@ -0,0 +1,296 @@
+// Copyright 2017 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Runs a large number of segment generators.
+
+#include "stages/segment_generator_bank.h"
+
+#include <algorithm>
+
+#include "stmlib/dsp/dsp.h"
+#include "stmlib/dsp/units.h"
+
+#include "stages/resources.h"
+
+namespace stages {
+
+using namespace std;
+using namespace stmlib;
+
+void SegmentGeneratorBank::Init(
+    SegmentGenerator* generators,
+    size_t num_channels) {
+  generator_ = generators;
+  num_channels_ = min(num_channels, kMaxNumBankChannels);
+  fill(&num_lanes_[0], &num_lanes_[GROUP_LAST], 0);
+}
+
+void SegmentGeneratorBank::Process(
+    const GateFlags* const* gate_flags,
+    SegmentGenerator::Output* const* out,
+    size_t size) {
+  if (!size) {
+    return;
+  }
+  
+  fill(&num_lanes_[0], &num_lanes_[GROUP_LAST], 0);
+  for (size_t i = 0; i < num_channels_; ++i) {
+    SegmentGenerator::ProcessFn fn = generator_[i].process_fn_;
+    Group group = GROUP_OTHER;
+    if (fn == &SegmentGenerator::ProcessDecayEnvelope) {
+      group = GROUP_DECAY_ENVELOPE;
+    } else if (fn == &SegmentGenerator::ProcessFreeRunningLFO) {
+      group = GROUP_FREE_RUNNING_LFO;
+    } else if (fn == &SegmentGenerator::ProcessMultiSegment) {
+      group = GROUP_MULTI_SEGMENT;
+    }
+    channel_[group][num_lanes_[group]++] = i;
+  }
+  
+  ProcessDecayEnvelopes(gate_flags, out, size);
+  ProcessFreeRunningLFOs(out, size);
+  ProcessMultiSegments(gate_flags, out, size);
+  
+  // The remaining channels are processed in order, since slaves depend on the
+  // output of the channel on their left.
+  for (size_t l = 0; l < num_lanes_[GROUP_OTHER]; ++l) {
+    size_t c = channel_[GROUP_OTHER][l];
+    SegmentGenerator* g = &generator_[c];
+    if (g->process_fn_ == &SegmentGenerator::ProcessSlave && c > 0) {
+      copy(&out[c - 1][0], &out[c - 1][size], &out[c][0]);
+    }
+    g->Process(gate_flags[c], out[c], size);
+  }
+}
+
+void SegmentGeneratorBank::ProcessDecayEnvelopes(
+    const GateFlags* const* gate_flags,
+    SegmentGenerator::Output* const* out,
+    size_t size) {
+  const size_t n = num_lanes_[GROUP_DECAY_ENVELOPE];
+  const uint16_t* channel = channel_[GROUP_DECAY_ENVELOPE];
+  
+  for (size_t l = 0; l < n; ++l) {
+    SegmentGenerator* g = &generator_[channel[l]];
+    phase_[l] = g->phase_;
+    active_segment_[l] = g->active_segment_;
+    frequency_[l] = g->RateToFrequency(g->parameters_[0].primary);
+    g->warp_.set_curve(g->parameters_[0].secondary);
+    warp_[l] = g->warp_;
+  }
+  
+  for (size_t t = 0; t < size; ++t) {
+    for (size_t l = 0; l < n; ++l) {
+      const bool rising = gate_flags[channel[l]][t] & GATE_FLAG_RISING;
+      float phase = rising ? 0.0f : phase_[l];
+      int segment = rising ? 0 : active_segment_[l];
+      phase += frequency_[l];
+      segment = phase >= 1.0f ? 1 : segment;
+      phase = phase >= 1.0f ? 1.0f : phase;
+      value_[l] = 1.0f - warp_[l].Warp(phase);
+      phase_[l] = phase;
+      active_segment_[l] = segment;
+    }
+    for (size_t l = 0; l < n; ++l) {
+      SegmentGenerator::Output* o = &out[channel[l]][t];
+      o->value = value_[l];
+      o->phase = phase_[l];
+      o->segment = active_segment_[l];
+    }
+  }
+  
+  for (size_t l = 0; l < n; ++l) {
+    SegmentGenerator* g = &generator_[channel[l]];
+    g->phase_ = phase_[l];
+    g->active_segment_ = active_segment_[l];
+    g->lp_ = g->value_ = value_[l];
+  }
+}
+
+void SegmentGeneratorBank::ProcessFreeRunningLFOs(
+    SegmentGenerator::Output* const* out,
+    size_t size) {
+  const size_t n = num_lanes_[GROUP_FREE_RUNNING_LFO];
+  const uint16_t* channel = channel_[GROUP_FREE_RUNNING_LFO];
+  
+  for (size_t l = 0; l < n; ++l) {
+    SegmentGenerator* g = &generator_[channel[l]];
+    phase_[l] = g->phase_;
+    
+    float f = 96.0f * (g->parameters_[0].primary - 0.5f);
+    CONSTRAIN(f, -128.0f, 127.0f);
+    frequency_[l] = SemitonesToRatio(f) * 2.0439497f / kSampleRate;
+    
+    g->lfo_shape_.set_shape(g->parameters_[0].secondary);
+    lfo_shape_[l] = g->lfo_shape_;
+  }
+  
+  for (size_t t = 0; t < size; ++t) {
+    for (size_t l = 0; l < n; ++l) {
+      const segment::LFOShape& s = lfo_shape_[l];
+      float ramp = phase_[l] + frequency_[l];
+      ramp = ramp >= 1.0f ? ramp - 1.0f : ramp;
+      phase_[l] = ramp;
+      
+      // Same as SegmentGenerator::ShapeLFO.
+      float phase = ramp + s.phase_shift;
+      phase = phase > 1.0f ? phase - 1.0f : phase;
+      const float up = s.slope_up * phase;
+      const float down = 1.0f - (phase - s.slope) * s.slope_down;
+      float triangle = (up < down ? up : down) - 0.5f;
+      triangle = min(max(triangle, -s.plateau), s.plateau);
+      triangle *= s.normalization;
+      const float sine = InterpolateWrap(lut_sine, phase + 0.75f, 1024.0f);
+      value_[l] = 0.5f * Crossfade(triangle, sine, s.sine_amount) + 0.5f;
+      active_segment_[l] = phase < 0.5f ? 0 : 1;
+    }
+    for (size_t l = 0; l < n; ++l) {
+      SegmentGenerator::Output* o = &out[channel[l]][t];
+      o->value = value_[l];
+      o->phase = phase_[l];
+      o->segment = active_segment_[l];
+    }
+  }
+  
+  for (size_t l = 0; l < n; ++l) {
+    SegmentGenerator* g = &generator_[channel[l]];
+    g->phase_ = phase_[l];
+    g->active_segment_ = active_segment_[l];
+  }
+}
+
+void SegmentGeneratorBank::LoadSegment(size_t l) {
+  SegmentGenerator& g = generator_[channel_[GROUP_MULTI_SEGMENT][l]];
+  const SegmentGenerator::Segment& segment = g.segments_[active_segment_[l]];
+  const SegmentGenerator::Segment& previous = \
+      g.segments_[previous_segment_[l]];
+  
+  // When the segment has no start value, the start value tracks the end of
+  // the previous segment. A coefficient of 0 disables tracking.
+  const bool track = !segment.start && previous.phase && \
+      segment.end != previous.end;
+  track_coefficient_[l] = track
+      ? g.PortamentoRateToLPCoefficient(*previous.portamento)
+      : 0.0f;
+  track_target_[l] = *previous.end;
+  
+  frequency_[l] = segment.time ? g.RateToFrequency(*segment.time) : 0.0f;
+  end_[l] = *segment.end;
+  portamento_[l] = g.PortamentoRateToLPCoefficient(*segment.portamento);
+  has_fixed_phase_[l] = segment.phase != NULL;
+  fixed_phase_[l] = segment.phase ? *segment.phase : 0.0f;
+  
+  g.warp_.set_curve(*segment.curve);
+  warp_[l] = g.warp_;
+}
+
+void SegmentGeneratorBank::GoToSegment(size_t l, int segment) {
+  const SegmentGenerator& g = generator_[channel_[GROUP_MULTI_SEGMENT][l]];
+  const SegmentGenerator::Segment& destination = g.segments_[segment];
+  phase_[l] = 0.0f;
+  start_[l] = destination.start
+      ? *destination.start
+      : (segment == active_segment_[l] ? start_[l] : value_[l]);
+  if (segment != active_segment_[l]) {
+    previous_segment_[l] = active_segment_[l];
+  }
+  active_segment_[l] = segment;
+  LoadSegment(l);
+}
+
+void SegmentGeneratorBank::ProcessMultiSegments(
+    const GateFlags* const* gate_flags,
+    SegmentGenerator::Output* const* out,
+    size_t size) {
+  const size_t n = num_lanes_[GROUP_MULTI_SEGMENT];
+  const uint16_t* channel = channel_[GROUP_MULTI_SEGMENT];
+  
+  for (size_t l = 0; l < n; ++l) {
+    const SegmentGenerator& g = generator_[channel[l]];
+    phase_[l] = g.phase_;
+    start_[l] = g.start_;
+    value_[l] = g.value_;
+    lp_[l] = g.lp_;
+    active_segment_[l] = g.active_segment_;
+    previous_segment_[l] = g.previous_segment_;
+    LoadSegment(l);
+  }
+  
+  for (size_t t = 0; t < size; ++t) {
+    // Advance all lanes in the current segment.
+    for (size_t l = 0; l < n; ++l) {
+      const float start = start_[l] + track_coefficient_[l] * \
+          (track_target_[l] - start_[l]);
+      float phase = phase_[l] + frequency_[l];
+      const bool complete = phase >= 1.0f;
+      phase = complete ? 1.0f : phase;
+      const float warped_phase = warp_[l].Warp(
+          has_fixed_phase_[l] ? fixed_phase_[l] : phase);
+      const float value = start + (end_[l] - start) * warped_phase;
+      lp_[l] += portamento_[l] * (value - lp_[l]);
+      start_[l] = start;
+      phase_[l] = phase;
+      value_[l] = value;
+      complete_[l] = complete;
+    }
+    
+    // Handle segment transitions, which are rare.
+    for (size_t l = 0; l < n; ++l) {
+      const SegmentGenerator& g = generator_[channel[l]];
+      const SegmentGenerator::Segment& segment = \
+          g.segments_[active_segment_[l]];
+      const GateFlags flags = gate_flags[channel[l]][t];
+      int go_to_segment = -1;
+      if (flags & GATE_FLAG_RISING) {
+        go_to_segment = segment.if_rising;
+      } else if (flags & GATE_FLAG_FALLING) {
+        go_to_segment = segment.if_falling;
+      } else if (complete_[l]) {
+        go_to_segment = segment.if_complete;
+      }
+      if (go_to_segment != -1) {
+        GoToSegment(l, go_to_segment);
+      }
+      
+      SegmentGenerator::Output* o = &out[channel[l]][t];
+      o->value = lp_[l];
+      o->phase = phase_[l];
+      o->segment = active_segment_[l];
+    }
+  }
+  
+  for (size_t l = 0; l < n; ++l) {
+    SegmentGenerator* g = &generator_[channel[l]];
+    g->phase_ = phase_[l];
+    g->start_ = start_[l];
+    g->value_ = value_[l];
+    g->lp_ = lp_[l];
+    g->active_segment_ = active_segment_[l];
+    g->previous_segment_ = previous_segment_[l];
+  }
+}
+
+}  // namespace stages
@@ -0,0 +1,123 @@
+// Copyright 2017 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Runs a large number of segment generators. The channels configured as
+// decay envelopes, free-running LFOs or multi-segment envelopes are grouped
+// by type, and processed together with their state laid out as arrays, so
+// that the inner loops run over channels and can be vectorized. The other
+// channels are processed one by one by their SegmentGenerator.
+
+#ifndef STAGES_SEGMENT_GENERATOR_BANK_H_
+#define STAGES_SEGMENT_GENERATOR_BANK_H_
+
+#include "stmlib/stmlib.h"
+#include "stmlib/utils/gate_flags.h"
+
+#include "stages/segment_generator.h"
+
+namespace stages {
+
+const size_t kMaxNumBankChannels = 256;
+
+class SegmentGeneratorBank {
+ public:
+  SegmentGeneratorBank() { }
+  ~SegmentGeneratorBank() { }
+  
+  // The generators are owned by the caller, and are configured as usual
+  // through their Configure() and set_segment_parameters() methods.
+  void Init(SegmentGenerator* generators, size_t num_channels);
+  
+  // gate_flags[i] and out[i] are the input and output buffers of channel i.
+  // Like in stages.cc, a channel configured as a slave sees the output of
+  // the previous channel.
+  void Process(
+      const stmlib::GateFlags* const* gate_flags,
+      SegmentGenerator::Output* const* out,
+      size_t size);
+  
+  // Same as the value returned by SegmentGenerator::Process().
+  inline bool first_segment_active(size_t channel) const {
+    return generator_[channel].active_segment_ == 0;
+  }
+  
+ private:
+  enum Group {
+    GROUP_DECAY_ENVELOPE,
+    GROUP_FREE_RUNNING_LFO,
+    GROUP_MULTI_SEGMENT,
+    GROUP_OTHER,
+    GROUP_LAST
+  };
+  
+  void ProcessDecayEnvelopes(
+      const stmlib::GateFlags* const* gate_flags,
+      SegmentGenerator::Output* const* out,
+      size_t size);
+  void ProcessFreeRunningLFOs(SegmentGenerator::Output* const* out, size_t size);
+  void ProcessMultiSegments(
+      const stmlib::GateFlags* const* gate_flags,
+      SegmentGenerator::Output* const* out,
+      size_t size);
+  
+  void LoadSegment(size_t lane);
+  void GoToSegment(size_t lane, int segment);
+  
+  SegmentGenerator* generator_;
+  size_t num_channels_;
+  
+  uint16_t channel_[GROUP_LAST][kMaxNumBankChannels];
+  size_t num_lanes_[GROUP_LAST];
+  
+  // State of each lane, copied from and back to the generators.
+  float phase_[kMaxNumBankChannels];
+  float start_[kMaxNumBankChannels];
+  float value_[kMaxNumBankChannels];
+  float lp_[kMaxNumBankChannels];
+  int active_segment_[kMaxNumBankChannels];
+  int previous_segment_[kMaxNumBankChannels];
+  
+  // Parameters of each lane, derived from the settings of the generator (or
+  // of its active segment) and constant during a block.
+  float frequency_[kMaxNumBankChannels];
+  segment::PhaseWarp warp_[kMaxNumBankChannels];
+  
+  float end_[kMaxNumBankChannels];
+  float portamento_[kMaxNumBankChannels];
+  float track_coefficient_[kMaxNumBankChannels];
+  float track_target_[kMaxNumBankChannels];
+  bool has_fixed_phase_[kMaxNumBankChannels];
+  float fixed_phase_[kMaxNumBankChannels];
+  bool complete_[kMaxNumBankChannels];
+  
+  segment::LFOShape lfo_shape_[kMaxNumBankChannels];
+  
+  DISALLOW_COPY_AND_ASSIGN(SegmentGeneratorBank);
+};
+
+}  // namespace stages
+
+#endif  // STAGES_SEGMENT_GENERATOR_BANK_H_
@@ -18,6 +18,8 @@
 #include <cstring>
 #include <cstdlib>
 
+#include "stages/segment_generator_bank.h"
+#include "tides2/ramp/shared_ramp_extractor.h"
 #include "stages/test/fixtures.h"
 
 using namespace stages;
@@ -140,6 +142,52 @@ void TestTapLFO() {
   t.Render("stages_tap_lfo.wav", ::kSampleRate);
 }
 
+void TestSharedClockSource() {
+  // An LFO following a shared clock must have the same phase as one running
+  // its own RampExtractor on the same gate stream, for all ratios.
+  const size_t kBlockSize = 8;
+  const float ratios[] = { 0.0f, 0.3f, 0.5f, 0.7f, 1.0f };
+  segment::Configuration configuration = { segment::TYPE_RAMP, true };
+  
+  for (size_t r = 0; r < sizeof(ratios) / sizeof(float); ++r) {
+    SegmentGenerator generator;
+    SegmentGenerator follower;
+    tides::SharedRampExtractor clock;
+    generator.Init();
+    follower.Init();
+    clock.Init(stages::kSampleRate, 1000.0f / stages::kSampleRate);
+    generator.Configure(true, &configuration, 1);
+    follower.Configure(true, &configuration, 1);
+    follower.set_clock_source(&clock);
+    generator.set_segment_parameters(0, ratios[r], 0.5f);
+    follower.set_segment_parameters(0, ratios[r], 0.5f);
+    
+    PulseGenerator pulses;
+    pulses.AddPulses(4000, 1000, 20);
+    pulses.AddPulses(8000, 7000, 20);
+    for (int i = 0; i < 100; ++i) {
+      int length = (rand() % 1200) + 400;
+      pulses.AddPulses(length, length / 4, 1);
+    }
+    
+    int num_errors = 0;
+    while (!pulses.empty()) {
+      GateFlags gate_flags[kBlockSize];
+      SegmentGenerator::Output a[kBlockSize];
+      SegmentGenerator::Output b[kBlockSize];
+      pulses.Render(gate_flags, kBlockSize);
+      generator.Process(gate_flags, a, kBlockSize);
+      clock.Process(gate_flags, kBlockSize);
+      follower.Process(gate_flags, b, kBlockSize);
+      for (size_t i = 0; i < kBlockSize; ++i) {
+        num_errors += a[i].phase != b[i].phase;
+      }
+    }
+    printf("Shared clock source, ratio %.1f: %d errors\n",
+           ratios[r], num_errors);
+  }
+}
+
 void TestDelay() {
   SegmentGeneratorTest t;
 
@@ -183,6 +231,43 @@ void TestDelayLine() {
   }
 }
 
+void TestFloatDelayLine() {
+  // Block reads must match interleaved Write/Read calls, for integral and
+  // fractional delays, across the wrap-around of the buffer.
+  float block_buffer[16];
+  float sample_buffer[16];
+  FloatDelayLine block;
+  FloatDelayLine sample;
+  block.Init(block_buffer, 16);
+  sample.Init(sample_buffer, 16);
+  
+  const float delays[] = { 4.0f, 5.3f, 12.0f, 15.5f };
+  int errors = 0;
+  for (int i = 0; i < 40; ++i) {
+    float in[3];
+    float out[3];
+    const float delay = delays[i % 4];
+    for (int j = 0; j < 3; ++j) {
+      in[j] = (3 * i + j) / 120.0f + 0.01f;
+    }
+    block.Read(delay, out, 3);
+    block.Write(in, 3);
+    for (int j = 0; j < 3; ++j) {
+      sample.Write(in[j]);
+      if (fabs(sample.Read(delay) - out[j]) > 1e-6f) {
+        ++errors;
+      }
+    }
+  }
+  
+  // Buffers whose size is not a power of two are rejected.
+  block.Init(block_buffer, 12);
+  if (block.size() != 0) {
+    ++errors;
+  }
+  printf("FloatDelayLine: %d errors\n", errors);
+}
+
 void TestAudioOscillator() {
   SegmentGeneratorTest t;
 
@@ -193,7 +278,100 @@ void TestAudioOscillator() {
   t.Render("stages_audio_oscillator.wav", ::kSampleRate);
 }
 
+void TestSegmentGeneratorBank() {
+  // The bank must give the same outputs as the generators processed one by
+  // one, whatever the mix of decay envelopes, free-running LFOs,
+  // multi-segment envelopes and other configurations.
+  const size_t kNumChannels = 16;
+  const size_t kBlockSize = 32;
+  static SegmentGenerator bank_generator[kNumChannels];
+  static SegmentGenerator generator[kNumChannels];
+  static SegmentGeneratorBank bank;
+  
+  srand(0);
+  for (size_t i = 0; i < kNumChannels; ++i) {
+    bank_generator[i].Init();
+    generator[i].Init();
+    
+    segment::Configuration configuration[6];
+    int num_segments = 1;
+    bool has_trigger = true;
+    switch (i % 4) {
+      case 0:
+        configuration[0].type = segment::TYPE_RAMP;
+        configuration[0].loop = false;
+        break;
+      case 1:
+        configuration[0].type = segment::TYPE_RAMP;
+        configuration[0].loop = true;
+        has_trigger = false;
+        break;
+      case 2:
+        num_segments = 2 + i % 5;
+        for (int j = 0; j < num_segments; ++j) {
+          configuration[j].type = j % 2 ? segment::TYPE_HOLD
+              : segment::TYPE_RAMP;
+          configuration[j].loop = j == 1;
+        }
+        break;
+      default:
+        configuration[0].type = segment::TYPE_STEP;
+        configuration[0].loop = false;
+        break;
+    }
+    bank_generator[i].Configure(has_trigger, configuration, num_segments);
+    generator[i].Configure(has_trigger, configuration, num_segments);
+    for (int j = 0; j < num_segments; ++j) {
+      float primary = (rand() % 1000) / 1000.0f;
+      float secondary = (rand() % 1000) / 1000.0f;
+      bank_generator[i].set_segment_parameters(j, primary, secondary);
+      generator[i].set_segment_parameters(j, primary, secondary);
+    }
+  }
+  bank.Init(bank_generator, kNumChannels);
+  
+  GateFlags gate_flags[kNumChannels][kBlockSize];
+  GateFlags previous_flags[kNumChannels];
+  fill(&previous_flags[0], &previous_flags[kNumChannels], GATE_FLAG_LOW);
+  const GateFlags* bank_gate_flags[kNumChannels];
+  SegmentGenerator::Output bank_out[kNumChannels][kBlockSize];
+  SegmentGenerator::Output* bank_out_ptr[kNumChannels];
+  for (size_t i = 0; i < kNumChannels; ++i) {
+    bank_gate_flags[i] = gate_flags[i];
+    bank_out_ptr[i] = bank_out[i];
+  }
+  
+  int errors = 0;
+  for (size_t n = 0; n < ::kSampleRate * 2; n += kBlockSize) {
+    for (size_t i = 0; i < kNumChannels; ++i) {
+      for (size_t j = 0; j < kBlockSize; ++j) {
+        bool gate = previous_flags[i] & GATE_FLAG_HIGH;
+        if (rand() % 500 == 0) {
+          gate = !gate;
+        }
+        previous_flags[i] = ExtractGateFlags(previous_flags[i], gate);
+        gate_flags[i][j] = previous_flags[i];
+      }
+    }
+    bank.Process(bank_gate_flags, bank_out_ptr, kBlockSize);
+    for (size_t i = 0; i < kNumChannels; ++i) {
+      SegmentGenerator::Output out[kBlockSize];
+      bool first_segment_active = generator[i].Process(
+          gate_flags[i], out, kBlockSize);
+      errors += first_segment_active != bank.first_segment_active(i);
+      for (size_t j = 0; j < kBlockSize; ++j) {
+        errors += out[j].value != bank_out[i][j].value;
+        errors += out[j].phase != bank_out[i][j].phase;
+        errors += out[j].segment != bank_out[i][j].segment;
+      }
+    }
+  }
+  printf("SegmentGeneratorBank: %d errors\n", errors);
+}
+
 int main(void) {
+  TestFloatDelayLine();
+  TestSegmentGeneratorBank();
   TestADSR();
   TestTwoStepSequence();
   TestSingleDecay();
@@ -203,6 +381,7 @@ int main(void) {
   TestPortamento();
   TestFreeRunningLFO();
   TestTapLFO();
+  TestSharedClockSource();
   TestDelay();
   TestZero();
   TestClockedSampleAndHold();
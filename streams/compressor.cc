@@ -130,8 +130,15 @@ void Compressor::Process(
     energy *= energy;
   }
   
+  *gain = ProcessLevel(energy);
+  // float ogain = powf(10.0f, 1.55f / 20.0f * (g - kUnityGain) / 256.0f);
+  // printf("%f %f\n", gain_reduction_ / 32768.0 * 24, 20 * logf(ogain) / logf(10.0f));
+  *frequency = 65535;
+}
+
+int32_t Compressor::ProcessLevel(int32_t energy) {
   // Detect the RMS level on the EXCITE or AUDIO input - whichever active.
-  error = energy - detector_;
+  int64_t error = energy - detector_;
   if (error > 0) {
     if (attack_coefficient_ == -1) {
       detector_ += error;
@@ -148,11 +155,18 @@ void Compressor::Process(
   if (g > 65535) {
     g = 65535;
   }
-  
-  *gain = g;
-  // float ogain = powf(10.0f, 1.55f / 20.0f * (g - kUnityGain) / 256.0f);
-  // printf("%f %f\n", gain_reduction_ / 32768.0 * 24, 20 * logf(ogain) / logf(10.0f));
-  *frequency = 65535;
+  return g;
+}
+
+void Compressor::Process(
+    const int16_t* audio,
+    const int16_t* excite,
+    uint16_t* gain,
+    uint16_t* frequency,
+    size_t size) {
+  while (size--) {
+    Process(*audio++, *excite++, gain++, frequency++);
+  }
 }
 
 }  // namespace streams
@@ -50,6 +50,12 @@ class Compressor {
       int16_t excite,
       uint16_t* gain,
       uint16_t* frequency);
+  void Process(
+      const int16_t* audio,
+      const int16_t* excite,
+      uint16_t* gain,
+      uint16_t* frequency,
+      size_t size);
   
   void Configure(bool alternate, int32_t* parameters, int32_t* globals) {
     uint16_t attack_time;
@@ -102,6 +108,10 @@ class Compressor {
     }
   }
   
+  // Runs the detector and gain computer on a squared level (the square of a
+  // 16-bit sample), and returns the gain as a DAC code.
+  int32_t ProcessLevel(int32_t energy);
+  
   inline int32_t gain_reduction() const { return gain_reduction_; }
   
  private:
@@ -125,4 +125,15 @@ void Envelope::Process(
   *frequency = frequency_offset_ + (scaled * frequency_amount_ >> 15);
 }
 
+void Envelope::Process(
+    const int16_t* audio,
+    const int16_t* excite,
+    uint16_t* gain,
+    uint16_t* frequency,
+    size_t size) {
+  while (size--) {
+    Process(*audio++, *excite++, gain++, frequency++);
+  }
+}
+
 }  // namespace streams
@@ -61,6 +61,16 @@ class FilterController {
     *gain = 0;
     *frequency = f;
   }
+  void Process(
+      const int16_t* audio,
+      const int16_t* excite,
+      uint16_t* gain,
+      uint16_t* frequency,
+      size_t size) {
+    while (size--) {
+      Process(*audio++, *excite++, gain++, frequency++);
+    }
+  }
 
   void Configure(bool alternate, int32_t* parameters, int32_t* globals) {
     int32_t amount = parameters[1];
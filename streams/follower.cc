@@ -134,4 +134,15 @@ void Follower::Process(
   }
 }
 
+void Follower::Process(
+    const int16_t* audio,
+    const int16_t* excite,
+    uint16_t* gain,
+    uint16_t* frequency,
+    size_t size) {
+  while (size--) {
+    Process(*audio++, *excite++, gain++, frequency++);
+  }
+}
+
 }  // namespace streams
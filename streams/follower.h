@@ -50,6 +50,12 @@ class Follower {
       int16_t excite,
       uint16_t* gain,
       uint16_t* frequency);
+  void Process(
+      const int16_t* audio,
+      const int16_t* excite,
+      uint16_t* gain,
+      uint16_t* frequency,
+      size_t size);
 
   void Configure(bool alternate, int32_t* parameters, int32_t* globals) {
     uint16_t attack_time;
@@ -79,4 +79,15 @@ void LorenzGenerator::Process(
   *frequency = 65535 + ((x_scaled - 65535) * vcf_amount_ >> 15);
 }
 
+void LorenzGenerator::Process(
+    const int16_t* audio,
+    const int16_t* excite,
+    uint16_t* gain,
+    uint16_t* frequency,
+    size_t size) {
+  while (size--) {
+    Process(*audio++, *excite++, gain++, frequency++);
+  }
+}
+
 }  // namespace streams
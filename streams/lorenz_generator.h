@@ -46,6 +46,12 @@ class LorenzGenerator {
       int16_t excite,
       uint16_t* gain,
       uint16_t* frequency);
+  void Process(
+      const int16_t* audio,
+      const int16_t* excite,
+      uint16_t* gain,
+      uint16_t* frequency,
+      size_t size);
   
   void set_index(uint8_t index) {
     index_ = index;
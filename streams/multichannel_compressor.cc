@@ -0,0 +1,105 @@
+// Copyright 2014 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+//
+// -----------------------------------------------------------------------------
+//
+// Linked compressor with lookahead.
+
+#include "streams/multichannel_compressor.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "streams/gain.h"
+
+namespace streams {
+
+using namespace std;
+
+// 256 LSB of DAC code <=> 1.55dB, converted to octaves.
+const float kGainCodeToOctaves = 1.55f / 20.0f / 256.0f * 3.321928f;
+
+// Full scale float sample <=> full scale 16-bit sample.
+const float kLevelScale = 32767.0f * 32767.0f;
+const float kMaxLevel = 2147483520.0f;
+
+void MultichannelCompressor::Init(size_t num_channels) {
+  compressor_.Init();
+  num_channels_ = min(num_channels, kMaxNumCompressorChannels);
+  set_lookahead(0);
+}
+
+void MultichannelCompressor::set_lookahead(size_t lookahead) {
+  lookahead_ = min(lookahead, kMaxCompressorLookahead);
+  write_ptr_ = 0;
+  for (size_t i = 0; i < kMaxNumCompressorChannels; ++i) {
+    fill(&delay_line_[i][0], &delay_line_[i][kDelayLineSize], 0.0f);
+  }
+}
+
+void MultichannelCompressor::Process(
+    const float* const* in,
+    float* const* out,
+    size_t size) {
+  float level[kBlockSize];
+  float gain[kBlockSize];
+  
+  for (size_t start = 0; start < size; start += kBlockSize) {
+    const size_t n = min(size - start, static_cast<size_t>(kBlockSize));
+    
+    // Peak of the squared levels over all channels.
+    fill(&level[0], &level[n], 0.0f);
+    for (size_t c = 0; c < num_channels_; ++c) {
+      const float* x = in[c] + start;
+      for (size_t i = 0; i < n; ++i) {
+        level[i] = max(level[i], x[i] * x[i]);
+      }
+    }
+    
+    // Detector and gain computer, shared by all channels.
+    for (size_t i = 0; i < n; ++i) {
+      int32_t energy = static_cast<int32_t>(
+          min(level[i] * kLevelScale, kMaxLevel));
+      int32_t g = compressor_.ProcessLevel(energy) - kUnityGain;
+      gain[i] = exp2f(static_cast<float>(g) * kGainCodeToOctaves);
+    }
+    
+    // Delay and apply the gain.
+    for (size_t c = 0; c < num_channels_; ++c) {
+      const float* x = in[c] + start;
+      float* y = out[c] + start;
+      float* line = delay_line_[c];
+      size_t write_ptr = write_ptr_;
+      for (size_t i = 0; i < n; ++i) {
+        line[write_ptr] = x[i];
+        y[i] = line[(write_ptr - lookahead_) & kDelayLineMask] * gain[i];
+        write_ptr = (write_ptr + 1) & kDelayLineMask;
+      }
+    }
+    write_ptr_ = (write_ptr_ + n) & kDelayLineMask;
+  }
+}
+
+}  // namespace streams
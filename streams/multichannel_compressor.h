@@ -0,0 +1,95 @@
+// Copyright 2014 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+//
+// -----------------------------------------------------------------------------
+//
+// Linked compressor for a bus of up to kMaxNumCompressorChannels float
+// channels, with a lookahead delay.
+//
+// The detector and the gain computer are those of Compressor, with the same
+// parameters (and times given at the 31.089kHz sample rate of the module).
+// They are driven by the peak of the squared levels of all channels, and the
+// resulting gain is applied to all of them, so that the stereo image is
+// preserved. The audio is delayed by the lookahead time, letting the detector
+// react before the transients reach the output.
+
+#ifndef STREAMS_MULTICHANNEL_COMPRESSOR_H_
+#define STREAMS_MULTICHANNEL_COMPRESSOR_H_
+
+#include "stmlib/stmlib.h"
+
+#include "streams/compressor.h"
+
+namespace streams {
+
+const size_t kMaxNumCompressorChannels = 8;
+const size_t kMaxCompressorLookahead = 1023;  // In samples.
+
+class MultichannelCompressor {
+ public:
+  MultichannelCompressor() { }
+  ~MultichannelCompressor() { }
+  
+  void Init(size_t num_channels);
+  
+  // Same as Compressor::Configure.
+  void Configure(bool alternate, int32_t* parameters, int32_t* globals) {
+    compressor_.Configure(alternate, parameters, globals);
+  }
+  
+  // Clears the delay line.
+  void set_lookahead(size_t lookahead);
+  
+  // Processes size samples of each channel, in[i] and out[i] pointing to the
+  // samples of channel i. The samples are in the [-1, 1] range. Processing can
+  // be done in place.
+  void Process(const float* const* in, float* const* out, size_t size);
+  
+  inline size_t num_channels() const { return num_channels_; }
+  inline size_t lookahead() const { return lookahead_; }
+  inline int32_t gain_reduction() const {
+    return compressor_.gain_reduction();
+  }
+  
+ private:
+  enum {
+    kBlockSize = 32,
+    kDelayLineSize = kMaxCompressorLookahead + 1,
+    kDelayLineMask = kDelayLineSize - 1
+  };
+  
+  Compressor compressor_;
+  size_t num_channels_;
+  size_t lookahead_;
+  size_t write_ptr_;
+  
+  float delay_line_[kMaxNumCompressorChannels][kDelayLineSize];
+  
+  DISALLOW_COPY_AND_ASSIGN(MultichannelCompressor);
+};
+
+}  // namespace streams
+
+#endif  // STREAMS_MULTICHANNEL_COMPRESSOR_H_
@@ -183,4 +183,15 @@ void Vactrol::Process(
        (frequency_amount_ * cutoff >> 15);
 }
 
+void Vactrol::Process(
+    const int16_t* audio,
+    const int16_t* excite,
+    uint16_t* gain,
+    uint16_t* frequency,
+    size_t size) {
+  while (size--) {
+    Process(*audio++, *excite++, gain++, frequency++);
+  }
+}
+
 }  // namespace streams
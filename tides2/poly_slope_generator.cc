@@ -24,14 +24,13 @@
 //
 // -----------------------------------------------------------------------------
 //
-// 4 related slope generators.
+// N related slope generators, all driven by the same master ramp.
 
 #include "tides2/poly_slope_generator.h"
 
 namespace tides {
   
-/* static */
-Ratio PolySlopeGenerator::audio_ratio_table_[21][PolySlopeGenerator::num_channels] = {
+Ratio audio_ratio_table[kNumRatios][kNumRatioTableChannels] = {
   { { 1.0f, 1 }, { 0.5f, 2 }, { 0.25f, 4 }, { 0.125f, 8 } },
   { { 1.0f, 1 }, { 0.5f, 2 }, { 0.33333333f, 3 }, { 0.2f, 5 } },
   { { 1.0f, 1 }, { 0.5f, 2 }, { 0.33333333f, 3 }, { 0.25f, 4 } },
@@ -57,8 +56,7 @@ Ratio PolySlopeGenerator::audio_ratio_table_[21][PolySlopeGenerator::num_channel
   { { 1.0f, 1 }, { 2.0f, 1 }, { 4.0f, 1 }, { 8.0f, 1 } },  // CCCC
 };
 
-/* static */
-Ratio PolySlopeGenerator::control_ratio_table_[21][PolySlopeGenerator::num_channels] = {
+Ratio control_ratio_table[kNumRatios][kNumRatioTableChannels] = {
   { { 1.0f, 1 }, { 0.5f, 2 }, { 0.25f, 4 }, { 0.125f, 8 } },
   { { 1.0f, 1 }, { 0.5f, 2 }, { 0.33333333f, 3 }, { 0.2f, 5 } },
   { { 1.0f, 1 }, { 0.5f, 2 }, { 0.33333333f, 3 }, { 0.25f, 4 } },
@@ -84,9 +82,4 @@ Ratio PolySlopeGenerator::control_ratio_table_[21][PolySlopeGenerator::num_chann
   { { 1.0f, 1 }, { 2.0f, 1 }, { 4.0f, 1 }, { 8.0f, 1 } },
 };
 
-/* static */
-PolySlopeGenerator::RenderFn PolySlopeGenerator::render_fn_table_[RAMP_MODE_LAST][
-    OUTPUT_MODE_LAST][RANGE_LAST];
-
-
 }  // namespace tides
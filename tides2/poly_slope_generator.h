@@ -24,7 +24,7 @@
 //
 // -----------------------------------------------------------------------------
 //
-// 4 related slope generators.
+// N related slope generators, all driven by the same master ramp.
 
 #ifndef TIDES_POLY_SLOPE_GENERATOR_H_
 #define TIDES_POLY_SLOPE_GENERATOR_H_
@@ -41,10 +41,19 @@
 namespace tides {
 
 #define INSTANTIATE(x, y, z) \
-  render_fn_table_[x][y][z] = &PolySlopeGenerator::RenderInternal<x, y, z>;
+  render_fn_table_[x][y][z] = &MultiSlopeGenerator::RenderInternal<x, y, z>;
 
 #define INSTANTIATE_RAM(x, y, z) \
-  render_fn_table_[x][y][z] = &PolySlopeGenerator::RenderInternal_RAM<x, y, z>;
+  render_fn_table_[x][y][z] = &MultiSlopeGenerator::RenderInternal_RAM<x, y, z>;
+
+const size_t kNumRatios = 21;
+const size_t kNumRatioTableChannels = 4;
+
+// Frequency ratios for the FREQUENCY output mode, as chosen by the SHIFT knob.
+// They are specified for 4 channels, and spread over the other channel
+// counts by MultiSlopeGenerator::SpreadRatios.
+extern Ratio audio_ratio_table[kNumRatios][kNumRatioTableChannels];
+extern Ratio control_ratio_table[kNumRatios][kNumRatioTableChannels];
 
 template<size_t num_channels>
 class Filter {
@@ -62,6 +71,30 @@ class Filter {
       float* f,
       float* in_out,
       size_t size) {
+#ifdef __SSE2__
+    if (num_effective_channels == num_channels && num_channels % 4 == 0) {
+      // Filter each group of 4 channels through the whole block, so that the
+      // state stays in registers.
+      for (size_t j = 0; j < num_channels; j += 4) {
+        const __m128 coefficient = _mm_loadu_ps(&f[j]);
+        __m128 lp_1 = _mm_loadu_ps(&lp_1_[j]);
+        __m128 lp_2 = _mm_loadu_ps(&lp_2_[j]);
+        float* p = &in_out[j];
+        for (size_t i = 0; i < size; ++i) {
+          const __m128 in = _mm_loadu_ps(p);
+          lp_1 = _mm_add_ps(
+              lp_1, _mm_mul_ps(coefficient, _mm_sub_ps(in, lp_1)));
+          lp_2 = _mm_add_ps(
+              lp_2, _mm_mul_ps(coefficient, _mm_sub_ps(lp_1, lp_2)));
+          _mm_storeu_ps(p, lp_2);
+          p += num_channels;
+        }
+        _mm_storeu_ps(&lp_1_[j], lp_1);
+        _mm_storeu_ps(&lp_2_[j], lp_2);
+      }
+      return;
+    }
+#endif  // __SSE2__
     while (size--) {
       for (size_t i = 0; i < num_effective_channels; ++i) {
         ONE_POLE(lp_1_[i], *in_out, f[i]);
@@ -79,14 +112,15 @@ class Filter {
   DISALLOW_COPY_AND_ASSIGN(Filter);
 };
 
-class PolySlopeGenerator {
+// The number of channels must be a multiple of 4. With more than 4 channels,
+// the SLOPE_PHASE and AMPLITUDE modes spread the shift over all channels, and
+// the FREQUENCY mode spreads the ratios. In the GATES mode, only the first 4
+// channels are used.
+template<size_t num_channels>
+class MultiSlopeGenerator {
  public:
-  PolySlopeGenerator() { }
-  ~PolySlopeGenerator() { }
-  
-  enum {
-    num_channels = 4
-  };
+  MultiSlopeGenerator() { }
+  ~MultiSlopeGenerator() { }
   
   struct OutputSample {
     float channel[num_channels];
@@ -97,6 +131,8 @@ class PolySlopeGenerator {
   }
   
   void Init() {
+    STATIC_ASSERT(num_channels % 4 == 0, invalid_number_of_channels);
+
     frequency_ = 0.01f;
     pw_ = 0.0f;
     shift_ = 0.0f;
@@ -110,7 +146,9 @@ class PolySlopeGenerator {
     }
     filter_.Init();
     
-    ratio_index_quantizer_.Init(21, 0.05f, false);
+    ratio_index_quantizer_.Init(kNumRatios, 0.05f, false);
+    ratio_index_ = -1;
+    ratio_range_ = RANGE_LAST;
     
     // Force template instantiation for all combinations of settings.
     INSTANTIATE(RAMP_MODE_AD, OUTPUT_MODE_GATES, RANGE_CONTROL);
@@ -141,7 +179,7 @@ class PolySlopeGenerator {
     INSTANTIATE_RAM(RAMP_MODE_LOOPING, OUTPUT_MODE_FREQUENCY, RANGE_AUDIO);
   }
   
-  typedef void (PolySlopeGenerator::*RenderFn)(
+  typedef void (MultiSlopeGenerator::*RenderFn)(
       float frequency, float pw, float shape, float smoothness, float shift,
       const stmlib::GateFlags* gate_flags, const float* ramp,
       OutputSample* output, size_t size);
@@ -198,7 +236,7 @@ class PolySlopeGenerator {
       ratio *= ratio;
       ratio *= ratio;
       
-      float f[4];
+      float f[num_channels];
       size_t last_channel = output_mode == OUTPUT_MODE_GATES ? 1 : num_channels;
       for (size_t i = 0; i < last_channel; ++i) {
         size_t source = output_mode == OUTPUT_MODE_FREQUENCY ? i : 0;
@@ -206,9 +244,9 @@ class PolySlopeGenerator {
         f[i] += (1.0f - f[i]) * ratio;
       }
       if (output_mode == OUTPUT_MODE_GATES) {
-        filter_.Process<1>(f, &out[0].channel[0], size);
+        filter_.template Process<1>(f, &out[0].channel[0], size);
       } else {
-        filter_.Process<num_channels>(f, &out[0].channel[0], size);
+        filter_.template Process<num_channels>(f, &out[0].channel[0], size);
       }
     }
   }
@@ -239,11 +277,14 @@ class PolySlopeGenerator {
     
     if (output_mode == OUTPUT_MODE_FREQUENCY) {
       const int ratio_index = ratio_index_quantizer_.Process(shift);
-      if (range == RANGE_CONTROL) {
-        ramp_generator_.set_next_ratio(control_ratio_table_[ratio_index]);
-      } else {
-        ramp_generator_.set_next_ratio(audio_ratio_table_[ratio_index]);
+      if (ratio_index != ratio_index_ || range != ratio_range_) {
+        SpreadRatios(range == RANGE_CONTROL
+            ? control_ratio_table[ratio_index]
+            : audio_ratio_table[ratio_index]);
+        ratio_index_ = ratio_index;
+        ratio_range_ = range;
       }
+      ramp_generator_.set_next_ratio(ratio_);
     }
     
     for (size_t i = 0; i < size; ++i) {
@@ -263,18 +304,18 @@ class PolySlopeGenerator {
       // Increment ramps.
       if (output_mode == OUTPUT_MODE_SLOPE_PHASE && ramp_mode == RAMP_MODE_AR) {
         if (ramp) {
-          ramp_generator_.Step<ramp_mode, output_mode, range, true>(
+          ramp_generator_.template Step<ramp_mode, output_mode, range, true>(
               f0, per_channel_pw, stmlib::GATE_FLAG_LOW, ramp[i]);
         } else {
-          ramp_generator_.Step<ramp_mode, output_mode, range, false>(
+          ramp_generator_.template Step<ramp_mode, output_mode, range, false>(
               f0, per_channel_pw, gate_flags[i], 0.0f);
         }
       } else {
         if (ramp) {
-          ramp_generator_.Step<ramp_mode, output_mode, range, true>(
+          ramp_generator_.template Step<ramp_mode, output_mode, range, true>(
               f0, &pw, stmlib::GATE_FLAG_LOW, ramp[i]);
         } else {
-          ramp_generator_.Step<ramp_mode, output_mode, range, false>(
+          ramp_generator_.template Step<ramp_mode, output_mode, range, false>(
               f0, &pw, gate_flags[i], 0.0f);
         }
       }
@@ -287,30 +328,49 @@ class PolySlopeGenerator {
       if (output_mode == OUTPUT_MODE_GATES) {
         const float phase = ramp_generator_.phase(0);
         const float frequency = ramp_generator_.frequency(0);
-        const float raw = ramp_shaper_[0].Slope<
+        const float raw = ramp_shaper_[0].template Slope<
               ramp_mode, range>(phase, 0.0f, frequency, pw);
-        const float slope = ramp_waveshaper_[0].Shape<
+        const float slope = ramp_waveshaper_[0].template Shape<
               ramp_mode>(raw, shape_table, shape_fractional);
 
         out[i].channel[0] = Fold<ramp_mode>(slope, fold) * shift;
         out[i].channel[1] = Scale<ramp_mode>(is_phasor
-            ? ramp_waveshaper_[1].Shape<ramp_mode>(
+            ? ramp_waveshaper_[1].template Shape<ramp_mode>(
                 raw, &lut_wavetable[8200], 0.0f)
             : raw);
-        out[i].channel[2] = ramp_shaper_[2].EOA<ramp_mode, range>(
+        out[i].channel[2] = ramp_shaper_[2].template EOA<ramp_mode, range>(
             phase, frequency, pw) * 8.0f;
-        out[i].channel[3] = ramp_shaper_[3].EOR<ramp_mode, range>(
+        out[i].channel[3] = ramp_shaper_[3].template EOR<ramp_mode, range>(
             phase, frequency, pw) * 8.0f;
+        std::fill(&out[i].channel[4], &out[i].channel[num_channels], 0.0f);
       } else if (output_mode == OUTPUT_MODE_AMPLITUDE) {
         const float phase = ramp_generator_.phase(0);
         const float frequency = ramp_generator_.frequency(0);
-        const float raw = ramp_shaper_[0].Slope<
+        const float raw = ramp_shaper_[0].template Slope<
               ramp_mode, range>(phase, 0.0f, frequency, pw);
-        const float shaped = ramp_waveshaper_[0].Shape<
+        const float shaped = ramp_waveshaper_[0].template Shape<
               ramp_mode>(raw, shape_table, shape_fractional);
         const float slope = Fold<ramp_mode>(shaped, fold) * \
               (shift < 0.0f ? -1.0f : + 1.0f);
-        const float channel_index = fabsf(shift * 5.1f);
+        const float channel_index = fabsf(
+            shift * (1.275f * float(num_channels)));
+#ifdef __SSE2__
+        const __m128 index = _mm_set1_ps(channel_index);
+        for (size_t j = 0; j < num_channels; j += 4) {
+          const float c = static_cast<float>(j + 1);
+          const __m128 channel = _mm_set_ps(c + 3.0f, c + 2.0f, c + 1.0f, c);
+          const __m128 abs_distance = _mm_andnot_ps(
+              _mm_set1_ps(-0.0f), _mm_sub_ps(channel, index));
+          const __m128 gain = _mm_max_ps(
+              _mm_sub_ps(_mm_set1_ps(1.0f), abs_distance), _mm_setzero_ps());
+          __m128 amplitude = _mm_mul_ps(_mm_set1_ps(slope), gain);
+          if (range == RANGE_AUDIO) {
+            amplitude = _mm_mul_ps(
+                amplitude, _mm_sub_ps(_mm_set1_ps(2.0f), gain));
+          }
+          _mm_storeu_ps(&out[i].channel[j], amplitude);
+        }
+#else
         for (size_t j = 0; j < num_channels; ++j) {
           const float channel = static_cast<float>(j + 1);
           const float gain = std::max(
@@ -318,35 +378,32 @@ class PolySlopeGenerator {
           const bool equal_pow = range == RANGE_AUDIO;
           out[i].channel[j] = slope * gain * (equal_pow ? (2.0f - gain) : 1.0f);
         }
+#endif  // __SSE2__
       } else if (output_mode == OUTPUT_MODE_SLOPE_PHASE) {
+        float raw[num_channels];
         float phase_shift = 0.0f;
         for (size_t j = 0; j < num_channels; ++j) {
           size_t source = ramp_mode == RAMP_MODE_AR ? j : 0;
-          out[i].channel[j] = Fold<ramp_mode>(
-              ramp_waveshaper_[j].Shape<ramp_mode>(
-                  ramp_shaper_[j].Slope<ramp_mode, range>(
-                      ramp_generator_.phase(source),
-                      phase_shift, 
-                      ramp_generator_.frequency(source),
-                      ramp_mode == RAMP_MODE_AD ? per_channel_pw[j] : pw),
-                  shape_table,
-                  shape_fractional),
-              fold);
+          raw[j] = ramp_shaper_[j].template Slope<ramp_mode, range>(
+              ramp_generator_.phase(source),
+              phase_shift, 
+              ramp_generator_.frequency(source),
+              ramp_mode == RAMP_MODE_AD ? per_channel_pw[j] : pw);
           phase_shift -= range == RANGE_AUDIO ? step : partial_step;
         }
+        ShapeAndFold<ramp_mode>(
+            raw, shape_table, shape_fractional, fold, out[i].channel);
       } else if (output_mode == OUTPUT_MODE_FREQUENCY) {
+        float raw[num_channels];
         for (size_t j = 0; j < num_channels; ++j) {
-          out[i].channel[j] = Fold<ramp_mode>(
-              ramp_waveshaper_[j].Shape<ramp_mode>(
-                  ramp_shaper_[j].Slope<ramp_mode, range>(
-                      ramp_generator_.phase(j),
-                      0.0f, 
-                      ramp_generator_.frequency(j),
-                      pw),
-                  shape_table,
-                  shape_fractional),
-              fold);
+          raw[j] = ramp_shaper_[j].template Slope<ramp_mode, range>(
+              ramp_generator_.phase(j),
+              0.0f, 
+              ramp_generator_.frequency(j),
+              pw);
         }
+        ShapeAndFold<ramp_mode>(
+            raw, shape_table, shape_fractional, fold, out[i].channel);
       }
     }
   }
@@ -366,6 +423,28 @@ class PolySlopeGenerator {
         frequency, pw, shape, smoothness, shift, gate_flags, ramp, out, size);
   }
   
+  template<RampMode ramp_mode>
+  inline void ShapeAndFold(
+      const float* raw,
+      const int16_t* shape_table,
+      float shape_fractional,
+      float fold,
+      float* out) {
+    float shaped[num_channels];
+    if (ramp_mode == RAMP_MODE_AR) {
+      for (size_t j = 0; j < num_channels; ++j) {
+        shaped[j] = ramp_waveshaper_[j].template Shape<ramp_mode>(
+            raw[j], shape_table, shape_fractional);
+      }
+    } else {
+      RampWaveshaper::Lookup<num_channels>(
+          raw, shape_table, shape_fractional, shaped);
+    }
+    for (size_t j = 0; j < num_channels; ++j) {
+      out[j] = Fold<ramp_mode>(shaped[j], fold);
+    }
+  }
+  
   template<RampMode ramp_mode>
   inline float Fold(float unipolar, float fold_amount) {
     if (ramp_mode == RAMP_MODE_LOOPING) {
@@ -393,6 +472,62 @@ class PolySlopeGenerator {
     }
   }
   
+  // Expands a row of the 4-channel ratio table to num_channels ratios. The
+  // ratios of the table are kept at channels 0, (n - 1) / 3, 2 (n - 1) / 3
+  // and n - 1; the channels in between are geometrically interpolated, then
+  // snapped to a fraction p / q, so that their phase wraps along with the
+  // master ramp every q cycles.
+  void SpreadRatios(const Ratio* row) {
+    if (num_channels == kNumRatioTableChannels) {
+      std::copy(&row[0], &row[num_channels], &ratio_[0]);
+      return;
+    }
+    const float scale = float(kNumRatioTableChannels - 1) / \
+        float(num_channels - 1);
+    for (size_t j = 0; j < num_channels; ++j) {
+      float position = float(j) * scale;
+      MAKE_INTEGRAL_FRACTIONAL(position);
+      if (position_integral >= int32_t(kNumRatioTableChannels - 1)) {
+        position_integral = kNumRatioTableChannels - 2;
+        position_fractional = 1.0f;
+      }
+      const Ratio& a = row[position_integral];
+      const Ratio& b = row[position_integral + 1];
+      if (position_fractional <= 0.001f) {
+        ratio_[j] = a;
+      } else if (position_fractional >= 0.999f) {
+        ratio_[j] = b;
+      } else {
+        ratio_[j] = Rationalize(a.ratio * powf(
+            b.ratio / a.ratio, position_fractional));
+      }
+    }
+  }
+  
+  // Closest fraction to ratio, with the smallest denominator giving an error
+  // below 1%.
+  static Ratio Rationalize(float ratio) {
+    const int kMaxDenominator = 16;
+    Ratio best = { 1.0f / float(kMaxDenominator), kMaxDenominator };
+    float best_error = fabsf(best.ratio - ratio);
+    for (int q = 1; q <= kMaxDenominator; ++q) {
+      const float p = floorf(ratio * float(q) + 0.5f);
+      if (p < 1.0f) {
+        continue;
+      }
+      const float error = fabsf(p / float(q) - ratio);
+      if (error < best_error) {
+        best.ratio = p / float(q);
+        best.q = q;
+        best_error = error;
+      }
+      if (error < 0.01f * ratio) {
+        break;
+      }
+    }
+    return best;
+  }
+  
   inline float Tame(float f0, float harmonics, float order) {
     f0 *= harmonics;
     float max_f = 0.5f * (1.0f / order);
@@ -408,6 +543,9 @@ class PolySlopeGenerator {
   float fold_;
   
   stmlib::HysteresisQuantizer2 ratio_index_quantizer_;
+  int ratio_index_;
+  Range ratio_range_;
+  Ratio ratio_[num_channels];
 
   RampGenerator<num_channels> ramp_generator_;
 
@@ -415,14 +553,21 @@ class PolySlopeGenerator {
   RampWaveshaper ramp_waveshaper_[num_channels];
   Filter<num_channels> filter_;
   
-  static Ratio audio_ratio_table_[21][num_channels];
-  static Ratio control_ratio_table_[21][num_channels];
   static RenderFn render_fn_table_[RAMP_MODE_LAST][OUTPUT_MODE_LAST][
       RANGE_LAST];
 
-  DISALLOW_COPY_AND_ASSIGN(PolySlopeGenerator);
+  DISALLOW_COPY_AND_ASSIGN(MultiSlopeGenerator);
 };
 
+/* static */
+template<size_t num_channels>
+typename MultiSlopeGenerator<num_channels>::RenderFn
+MultiSlopeGenerator<num_channels>::render_fn_table_[RAMP_MODE_LAST][
+    OUTPUT_MODE_LAST][RANGE_LAST];
+
+// The 4 outputs of the module.
+typedef MultiSlopeGenerator<4> PolySlopeGenerator;
+
 }  // namespace tides
 
 #endif  // TIDES_POLY_SLOPE_GENERATOR_H_
@@ -55,18 +55,19 @@ void RampExtractor::Init(float sample_rate, float max_frequency) {
   max_frequency_ = max_frequency;
   min_period_ = 1.0f / max_frequency_;
   sample_rate_ = sample_rate;
+  train_.max_phase = 0.0f;
   Reset();
 }
 
 void RampExtractor::Reset() {
-  train_phase_ = 0.0f;
-  target_frequency_ = frequency_lp_ = frequency_ = 0.1f / sample_rate_;
-  period_ = int(1.0f / frequency_);
+  train_.phase = 0.0f;
+  target_frequency_ = frequency_lp_ = train_.frequency = 0.1f / sample_rate_;
+  period_ = int(1.0f / train_.frequency);
   
   lp_coefficient_ = 0.1f;
   max_ramp_value_ = 1.0f;
-  f_ratio_ = 1.0f;
-  reset_counter_ = 1;
+  train_.f_ratio = 1.0f;
+  train_.reset_counter = 1;
   reset_interval_ = uint32_t(sample_rate_) * 3;
 
   Pulse p;
@@ -139,6 +140,69 @@ float RampExtractor::Process(
   }
 }
 
+inline void RampExtractor::AnalyzeSample(GateFlags flags, ClockEvent* e) {
+  e->reset = false;
+  e->pulse = false;
+  e->frequency = 0.0f;
+  e->pulse_width = 0.0f;
+  e->on_duration = 0.0f;
+
+  // We are done with the previous pulse.
+  if (flags & GATE_FLAG_RISING) {
+    Pulse& p = history_[current_pulse_];
+    
+    const bool record_pulse = p.total_duration < reset_interval_;
+    if (!record_pulse) {
+      e->reset = true;
+      reset_interval_ = 4 * p.total_duration;
+    } else {
+      // Compute the pulse width of the previous pulse, and check if the
+      // PW has been consistent over the past pulses.
+      float period = float(p.total_duration);
+      if (period < min_period_) {
+        target_frequency_ = 1.0f / period;
+      } else {
+        p.pulse_width = static_cast<float>(p.on_duration) / \
+            static_cast<float>(p.total_duration);
+        average_pulse_width_ = ComputeAveragePulseWidth(
+            kPulseWidthTolerance);
+        if (p.on_duration < 32) {
+          average_pulse_width_ = 0.0f;
+        }
+        target_frequency_ = 1.0f / PredictNextPeriod();
+      }
+      e->pulse = true;
+      e->frequency = target_frequency_;
+      reset_interval_ = static_cast<uint32_t>(
+          std::max(4.0f / target_frequency_, sample_rate_ * 3.0f));
+      current_pulse_ = (current_pulse_ + 1) % kHistorySize;
+    }
+    // Record a new pulse.
+    history_[current_pulse_].on_duration = 0;
+    history_[current_pulse_].total_duration = 0;
+  }
+  
+  // Update history buffer with total duration and on duration.
+  ++history_[current_pulse_].total_duration;
+  if (flags & GATE_FLAG_HIGH) {
+    ++history_[current_pulse_].on_duration;
+  }
+  
+  if ((flags & GATE_FLAG_FALLING) && average_pulse_width_ > 0.0f) {
+    e->pulse_width = average_pulse_width_;
+    e->on_duration = static_cast<float>(history_[current_pulse_].on_duration);
+  }
+}
+
+void RampExtractor::Analyze(
+    const GateFlags* gate_flags,
+    ClockEvent* events,
+    size_t size) {
+  while (size--) {
+    AnalyzeSample(*gate_flags++, events++);
+  }
+}
+
 template<bool smooth_audio_rate_tracking>
 inline float RampExtractor::ProcessInternal(
     bool force_integer_period,
@@ -146,6 +210,15 @@ inline float RampExtractor::ProcessInternal(
     const GateFlags* gate_flags,
     float* ramp, 
     size_t size) {
+  if (!smooth_audio_rate_tracking) {
+    while (size--) {
+      ClockEvent e;
+      AnalyzeSample(*gate_flags++, &e);
+      *ramp++ = train_.Process(e, ratio);
+    }
+    return train_.frequency * train_.f_ratio;
+  }
+  
   const size_t block_size = size;
   while (size--) {
     GateFlags flags = *gate_flags++;
@@ -155,80 +228,48 @@ inline float RampExtractor::ProcessInternal(
       
       const bool record_pulse = p.total_duration < reset_interval_;
       if (!record_pulse) {
-        reset_counter_ = ratio.q;
-        train_phase_ = 0.0f;
-        f_ratio_ = ratio.ratio;
-        max_train_phase_ = static_cast<float>(ratio.q);
+        train_.Restart(ratio);
         reset_interval_ = 4 * p.total_duration;
       } else {
         float period = float(p.total_duration);
-        if (smooth_audio_rate_tracking) {
-          bool no_glide = f_ratio_ != ratio.ratio;
-          f_ratio_ = ratio.ratio;
-          
-          --reset_counter_;
+        bool no_glide = train_.f_ratio != ratio.ratio;
+        train_.f_ratio = ratio.ratio;
+        
+        --train_.reset_counter;
 
-          float phase_error = 0.0f;
-          if (!reset_counter_) {
-            reset_counter_ = ratio.q;
-            
-            // Compensates for the latency in the acquisition of the
-            // external signal.
-            float expected_phase = 2.0f * \
-                float(block_size) / period * f_ratio_;
-            while (expected_phase >= 1.0f) {
-              expected_phase -= 1.0f;
-            }
-            phase_error = train_phase_ - expected_phase;
-            if (phase_error > 0.5f) {
-              phase_error -= 1.0f;
-            }
-            if (phase_error < -0.5f) {
-              phase_error += 1.0f;
-            }
+        float phase_error = 0.0f;
+        if (!train_.reset_counter) {
+          train_.reset_counter = ratio.q;
+          
+          // Compensates for the latency in the acquisition of the
+          // external signal.
+          float expected_phase = 2.0f * \
+              float(block_size) / period * train_.f_ratio;
+          while (expected_phase >= 1.0f) {
+            expected_phase -= 1.0f;
           }
-        
-          const float frequency = 1.0f / period;
-          float pll_adjustment = 1.0f - \
-              lp_coefficient_ * phase_error / f_ratio_;
-          CONSTRAIN(pll_adjustment, 0.99f, 1.01f)
-          target_frequency_ = std::min(
-              f_ratio_ * frequency * pll_adjustment, 0.125f);
-        
-          float up_tolerance = (1.02f + 2.0f * frequency) * frequency_lp_;
-          float down_tolerance = (0.98f - 2.0f * frequency) * frequency_lp_;
-          no_glide |= target_frequency_ > up_tolerance ||
-              target_frequency_ < down_tolerance;
-          lp_coefficient_ = no_glide ? 1.0f : min(period * 0.00001f, 0.1f);
-        } else {
-          // Compute the pulse width of the previous pulse, and check if the
-          // PW has been consistent over the past pulses.
-          if (period < min_period_) {
-            frequency_ = target_frequency_ = 1.0f / period;
-          } else {
-            p.pulse_width = static_cast<float>(p.on_duration) / \
-                static_cast<float>(p.total_duration);
-            average_pulse_width_ = ComputeAveragePulseWidth(
-                kPulseWidthTolerance);
-            if (p.on_duration < 32) {
-              average_pulse_width_ = 0.0f;
-            }
-            frequency_ = target_frequency_ = 1.0f / PredictNextPeriod();
+          phase_error = train_.phase - expected_phase;
+          if (phase_error > 0.5f) {
+            phase_error -= 1.0f;
           }
-
-          --reset_counter_;
-          if (!reset_counter_) {
-            train_phase_ = 0.0f;
-            reset_counter_ = ratio.q;
-            f_ratio_ = ratio.ratio;
-            max_train_phase_ = static_cast<float>(ratio.q);
-          } else {
-            float expected = max_train_phase_ - static_cast<float>(
-                reset_counter_);
-            float warp =  expected - train_phase_ + 1.0f;
-            frequency_ *= max(warp, 0.01f);
+          if (phase_error < -0.5f) {
+            phase_error += 1.0f;
           }
         }
+      
+        const float frequency = 1.0f / period;
+        float pll_adjustment = 1.0f - \
+            lp_coefficient_ * phase_error / train_.f_ratio;
+        CONSTRAIN(pll_adjustment, 0.99f, 1.01f)
+        target_frequency_ = std::min(
+            train_.f_ratio * frequency * pll_adjustment, 0.125f);
+      
+        float up_tolerance = (1.02f + 2.0f * frequency) * frequency_lp_;
+        float down_tolerance = (0.98f - 2.0f * frequency) * frequency_lp_;
+        no_glide |= target_frequency_ > up_tolerance ||
+            target_frequency_ < down_tolerance;
+        lp_coefficient_ = no_glide ? 1.0f : min(period * 0.00001f, 0.1f);
+        
         reset_interval_ = static_cast<uint32_t>(
             std::max(4.0f / target_frequency_, sample_rate_ * 3.0f));
         current_pulse_ = (current_pulse_ + 1) % kHistorySize;
@@ -244,43 +285,23 @@ inline float RampExtractor::ProcessInternal(
       ++history_[current_pulse_].on_duration;
     }
     
-    if (smooth_audio_rate_tracking) {
-      ONE_POLE(frequency_lp_, target_frequency_, lp_coefficient_);
-      if (force_integer_period) {
-        int new_period = int(1.0f / frequency_lp_);
-        if (abs(new_period - period_) > 1) {
-          period_ = new_period;
-          frequency_ = 1.0f / float(new_period);
-        }
-      } else {
-        frequency_ = frequency_lp_;
+    ONE_POLE(frequency_lp_, target_frequency_, lp_coefficient_);
+    if (force_integer_period) {
+      int new_period = int(1.0f / frequency_lp_);
+      if (abs(new_period - period_) > 1) {
+        period_ = new_period;
+        train_.frequency = 1.0f / float(new_period);
       }
-      train_phase_ += frequency_;
-      if (train_phase_ >= 1.0f) {
-        train_phase_ -= 1.0f;
-      }
-      *ramp++ = train_phase_;
     } else {
-      if ((flags & GATE_FLAG_FALLING) &&
-          average_pulse_width_ > 0.0f) {
-        float t_on = static_cast<float>(
-            history_[current_pulse_].on_duration);
-        float next = max_train_phase_ - static_cast<float>(
-            reset_counter_) + 1.0f;
-        float pw = average_pulse_width_;
-        frequency_ = max((next - train_phase_), 0.0f) * pw / \
-            ((1.0f - pw) * t_on);
-      }
-      train_phase_ += frequency_;
-      if (train_phase_ >= max_train_phase_) {
-        train_phase_ = max_train_phase_;
-      }
-      float phase = train_phase_ * f_ratio_;
-      phase -= static_cast<float>(static_cast<int32_t>(phase));
-      *ramp++ = phase;
+      train_.frequency = frequency_lp_;
+    }
+    train_.phase += train_.frequency;
+    if (train_.phase >= 1.0f) {
+      train_.phase -= 1.0f;
     }
+    *ramp++ = train_.phase;
   }
-  return smooth_audio_rate_tracking ? frequency_ : frequency_ * f_ratio_;
+  return train_.frequency;
 }
 
 }  // namespace tides
\ No newline at end of file
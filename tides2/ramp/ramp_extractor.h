@@ -40,12 +40,73 @@
 #include "stmlib/stmlib.h"
 #include "stmlib/utils/gate_flags.h"
 
+#include <algorithm>
+
 #include "tides2/ramp/ratio.h"
 
 namespace tides {
 
 const int kMaxPatternPeriod = 8;
 
+// Outcome of the control-rate analysis of one sample of the clock signal.
+struct ClockEvent {
+  bool reset;  // First pulse after a long pause.
+  bool pulse;  // Any other pulse, with the predicted frequency of the clock.
+  float frequency;
+  
+  // On a falling edge, when the pulse width is consistent enough to predict
+  // the time of the next pulse from the on time. 0 otherwise.
+  float pulse_width;
+  float on_duration;
+};
+
+// Ramp following the clock events at a given ratio. Its phase counts clock
+// periods from 0 to q, and the speed is warped at each pulse so that the
+// phase reaches q on the q-th pulse.
+struct RampTrain {
+  float phase;
+  float frequency;
+  float f_ratio;
+  float max_phase;
+  int reset_counter;
+  
+  inline void Restart(Ratio ratio) {
+    reset_counter = ratio.q;
+    phase = 0.0f;
+    f_ratio = ratio.ratio;
+    max_phase = static_cast<float>(ratio.q);
+  }
+  
+  inline float Process(const ClockEvent& e, Ratio ratio) {
+    if (e.reset) {
+      Restart(ratio);
+    } else if (e.pulse) {
+      frequency = e.frequency;
+      --reset_counter;
+      if (!reset_counter) {
+        Restart(ratio);
+      } else {
+        float expected = max_phase - static_cast<float>(reset_counter);
+        float warp =  expected - phase + 1.0f;
+        frequency *= std::max(warp, 0.01f);
+      }
+    }
+    if (e.pulse_width > 0.0f) {
+      float next = max_phase - static_cast<float>(reset_counter) + 1.0f;
+      float pw = e.pulse_width;
+      frequency = std::max((next - phase), 0.0f) * pw / \
+          ((1.0f - pw) * e.on_duration);
+    }
+    phase += frequency;
+    if (phase >= max_phase) {
+      phase = max_phase;
+    }
+    float ramp = phase * f_ratio;
+    ramp -= static_cast<float>(static_cast<int32_t>(ramp));
+    return ramp;
+  }
+};
+
 class RampExtractor {
  public:
   RampExtractor() { }
@@ -61,6 +122,12 @@ class RampExtractor {
       const stmlib::GateFlags* gate_flags,
       float* ramp,
       size_t size);
+  
+  // Control-rate analysis of the clock alone, for ramps driven by RampTrain.
+  void Analyze(
+      const stmlib::GateFlags* gate_flags,
+      ClockEvent* events,
+      size_t size);
 
  private:
   struct Pulse {
@@ -74,6 +141,8 @@ class RampExtractor {
   float ComputeAveragePulseWidth(float tolerance) const;
   
   float PredictNextPeriod();
+  
+  inline void AnalyzeSample(stmlib::GateFlags flags, ClockEvent* e);
 
   template<bool smooth_audio_rate_tracking>
   inline float ProcessInternal(
@@ -90,17 +159,13 @@ class RampExtractor {
   float predicted_period_[kMaxPatternPeriod + 1];
   float average_pulse_width_;
   
-  float train_phase_;
+  RampTrain train_;
   float frequency_lp_;
-  float frequency_;
   float target_frequency_;
   float lp_coefficient_;
   int period_;
   
-  int reset_counter_;
   float max_ramp_value_;
-  float f_ratio_;
-  float max_train_phase_;
   uint32_t reset_interval_;
   
   float max_frequency_;
@@ -0,0 +1,128 @@
+// Copyright 2017 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Clock tracking shared by several ramp generators. A single RampExtractor
+// analyzes the pulse history of the clock, and each RampFollower drives its
+// own ramp train from the resulting events, at its own ratio. The cost of the
+// analysis is thus paid once per clock source rather than once per generator,
+// and the ramps are identical to those of a RampExtractor tracking the clock
+// at control rate.
+
+#ifndef TIDES_RAMP_SHARED_RAMP_EXTRACTOR_H_
+#define TIDES_RAMP_SHARED_RAMP_EXTRACTOR_H_
+
+#include "stmlib/stmlib.h"
+
+#include <algorithm>
+
+#include "stmlib/utils/gate_flags.h"
+
+#include "tides2/ramp/ramp_extractor.h"
+#include "tides2/ramp/ratio.h"
+
+namespace tides {
+
+const size_t kMaxSharedRampBlockSize = 32;
+
+class SharedRampExtractor {
+ public:
+  SharedRampExtractor() { }
+  ~SharedRampExtractor() { }
+  
+  void Init(float sample_rate, float max_frequency) {
+    ramp_extractor_.Init(sample_rate, max_frequency);
+    Reset();
+  }
+  
+  void Reset() {
+    ramp_extractor_.Reset();
+    size_ = 0;
+  }
+  
+  // Analyzes a block of at most kMaxSharedRampBlockSize samples of the clock
+  // signal. Must be called once per block, before any of the followers.
+  void Process(const stmlib::GateFlags* gate_flags, size_t size) {
+    size_ = std::min(size, kMaxSharedRampBlockSize);
+    ramp_extractor_.Analyze(gate_flags, events_, size_);
+  }
+  
+  inline const ClockEvent* events() const { return events_; }
+  inline size_t size() const { return size_; }
+
+ private:
+  RampExtractor ramp_extractor_;
+  
+  ClockEvent events_[kMaxSharedRampBlockSize];
+  size_t size_;
+  
+  DISALLOW_COPY_AND_ASSIGN(SharedRampExtractor);
+};
+
+class RampFollower {
+ public:
+  RampFollower() { }
+  ~RampFollower() { }
+  
+  void Init(float sample_rate) {
+    initial_frequency_ = 0.1f / sample_rate;
+    train_.max_phase = 0.0f;
+    Reset();
+  }
+  
+  void Reset() {
+    train_.phase = 0.0f;
+    train_.frequency = initial_frequency_;
+    train_.f_ratio = 1.0f;
+    train_.reset_counter = 1;
+  }
+  
+  // Renders the ramp at the given ratio from the last block analyzed by the
+  // shared extractor, and returns its frequency. Samples past the end of the
+  // block analyzed by the extractor hold the last phase.
+  float Process(
+      const SharedRampExtractor& source,
+      Ratio ratio,
+      float* ramp,
+      size_t size) {
+    const ClockEvent* events = source.events();
+    const size_t n = std::min(size, source.size());
+    for (size_t i = 0; i < n; ++i) {
+      ramp[i] = train_.Process(events[i], ratio);
+    }
+    std::fill(&ramp[n], &ramp[size], n ? ramp[n - 1] : 0.0f);
+    return train_.frequency * train_.f_ratio;
+  }
+
+ private:
+  RampTrain train_;
+  float initial_frequency_;
+  
+  DISALLOW_COPY_AND_ASSIGN(RampFollower);
+};
+
+}  // namespace tides
+
+#endif  // TIDES_RAMP_SHARED_RAMP_EXTRACTOR_H_
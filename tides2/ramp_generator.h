@@ -36,9 +36,34 @@
 
 #include <algorithm>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif  // __SSE2__
+
 #include "tides2/ramp/ratio.h"
 
 namespace tides {
+
+#ifdef __SSE2__
+
+// When a block of 4 channels is processed, the 4 channels are kept in a SSE
+// register. These are the few helpers needed for that.
+inline __m128 Select(__m128 condition, __m128 if_true, __m128 if_false) {
+  return _mm_or_ps(
+      _mm_and_ps(condition, if_true),
+      _mm_andnot_ps(condition, if_false));
+}
+
+inline __m128 LoadRatios(const Ratio* r) {
+  return _mm_set_ps(r[3].ratio, r[2].ratio, r[1].ratio, r[0].ratio);
+}
+
+// Same as MAKE_INTEGRAL_FRACTIONAL.
+inline __m128 Fractional(__m128 x) {
+  return _mm_sub_ps(x, _mm_cvtepi32_ps(_mm_cvttps_epi32(x)));
+}
+
+#endif  // __SSE2__
   
 enum RampMode {
   RAMP_MODE_AD,
@@ -111,15 +136,11 @@ class RampGenerator {
       if (gate_flags & stmlib::GATE_FLAG_RISING) {
         std::fill(&phase_[0], &phase_[n], 0.0f);
       }
-      
-      for (size_t i = 0; i < n; ++i) {
-        frequency_[i] = std::min(f0 * next_ratio_[i].ratio, 0.25f);
-        if (use_ramp) {
-          phase_[i] = ramp * next_ratio_[i].ratio;
-        } else {
-          phase_[i] += frequency_[i];
-        }
-        phase_[i] = std::min(phase_[i], 1.0f);
+      ComputeFrequencies<n>(f0, next_ratio_);
+      if (use_ramp) {
+        RampPhases<n>(ramp, next_ratio_);
+      } else {
+        AdvancePhases<n>(false);
       }
     }
     
@@ -127,28 +148,13 @@ class RampGenerator {
       if (output_mode == OUTPUT_MODE_SLOPE_PHASE) {
         std::fill(&frequency_[0], &frequency_[n], f0);
       } else {
-        for (size_t i = 0; i < n; ++i) {
-          frequency_[i] = std::min(f0 * next_ratio_[i].ratio, 0.25f);
-        }
+        ComputeFrequencies<n>(f0, next_ratio_);
       }
       
       const bool should_ramp_up = use_ramp
           ? ramp < 0.5f : gate_flags & stmlib::GATE_FLAG_HIGH;
-    
-      float clip_at = should_ramp_up ? 0.5f : 1.0f;
-      for (size_t i = 0; i < n; ++i) {
-        if (phase_[i] < 0.5f && !should_ramp_up) {
-          phase_[i] = 0.5f;
-        } else if (phase_[i] > 0.5f && should_ramp_up) {
-          phase_[i] = 0.0f;
-        }
-        float this_pw = output_mode == OUTPUT_MODE_FREQUENCY ? pw[0] : pw[i];
-        float slope = phase_[i] < 0.5f
-            ? 0.5f / (1.0e-6f + this_pw)
-            : 0.5f / (1.0f + 1.0e-6f - this_pw);
-        phase_[i] += frequency_[i] * slope;
-        phase_[i] = std::min(phase_[i], clip_at);
-      }
+      AdvanceAttackReleasePhases<n, output_mode != OUTPUT_MODE_FREQUENCY>(
+          pw, should_ramp_up);
     }
     
     if (ramp_mode == RAMP_MODE_LOOPING) {
@@ -160,22 +166,13 @@ class RampGenerator {
           std::fill(&phase_[0], &phase_[n], 0.0f);
           reset = true;
         }
-        for (size_t i = 0; i < n; ++i) {
-          frequency_[i] = std::min(f0 * next_ratio_[i].ratio, 0.25f);
-        }
+        ComputeFrequencies<n>(f0, next_ratio_);
         if (!reset) {
-          for (size_t i = 0; i < n; ++i) {
-            phase_[i] += frequency_[i];
-            if (phase_[i] >= 1.0f) {
-              phase_[i] -= 1.0f;
-            }
-          }
+          AdvancePhases<n>(true);
         }
       } else {
         if (use_ramp) {
-          for (size_t i = 0; i < n; ++i) {
-            frequency_[i] = std::min(f0 * ratio_[i].ratio, 0.25f);
-          }
+          ComputeFrequencies<n>(f0, ratio_);
           if (ramp < master_phase_) {
             for (size_t i = 0; i < n; ++i) {
               ++wrap_counter_[i];
@@ -194,9 +191,7 @@ class RampGenerator {
             std::fill(&wrap_counter_[0], &wrap_counter_[n], 0);
             reset = true;
           }
-          for (size_t i = 0; i < n; ++i) {
-            frequency_[i] = std::min(f0 * ratio_[i].ratio, 0.25f);
-          }
+          ComputeFrequencies<n>(f0, ratio_);
           if (!reset) {
             master_phase_ += f0;
           }
@@ -211,17 +206,143 @@ class RampGenerator {
             }
           }
         }
-        for (size_t i = 0; i < n; ++i) {
-          float mult_phase = master_phase_ + float(wrap_counter_[i]);
-          mult_phase *= ratio_[i].ratio;
-          MAKE_INTEGRAL_FRACTIONAL(mult_phase);
-          phase_[i] = mult_phase_fractional;
-        }
+        ComputeMultipliedPhases<n>();
       }
     }
   }
   
  private:
+  // The per-channel computations below have a SSE version, processing the
+  // channels in groups of 4, for when the number of active channels is a
+  // multiple of 4.
+  template<size_t n>
+  inline void ComputeFrequencies(float f0, const Ratio* ratio) {
+#ifdef __SSE2__
+    if (n % 4 == 0) {
+      for (size_t i = 0; i < n; i += 4) {
+        _mm_storeu_ps(&frequency_[i], _mm_min_ps(
+            _mm_mul_ps(_mm_set1_ps(f0), LoadRatios(&ratio[i])),
+            _mm_set1_ps(0.25f)));
+      }
+      return;
+    }
+#endif  // __SSE2__
+    for (size_t i = 0; i < n; ++i) {
+      frequency_[i] = std::min(f0 * ratio[i].ratio, 0.25f);
+    }
+  }
+  
+  template<size_t n>
+  inline void RampPhases(float ramp, const Ratio* ratio) {
+#ifdef __SSE2__
+    if (n % 4 == 0) {
+      for (size_t i = 0; i < n; i += 4) {
+        _mm_storeu_ps(&phase_[i], _mm_min_ps(
+            _mm_mul_ps(_mm_set1_ps(ramp), LoadRatios(&ratio[i])),
+            _mm_set1_ps(1.0f)));
+      }
+      return;
+    }
+#endif  // __SSE2__
+    for (size_t i = 0; i < n; ++i) {
+      phase_[i] = std::min(ramp * ratio[i].ratio, 1.0f);
+    }
+  }
+  
+  // Increments the phases, then either wraps or clips them.
+  template<size_t n>
+  inline void AdvancePhases(bool wrap) {
+#ifdef __SSE2__
+    if (n % 4 == 0) {
+      const __m128 one = _mm_set1_ps(1.0f);
+      for (size_t i = 0; i < n; i += 4) {
+        __m128 phase = _mm_add_ps(
+            _mm_loadu_ps(&phase_[i]),
+            _mm_loadu_ps(&frequency_[i]));
+        phase = wrap
+            ? Select(_mm_cmpge_ps(phase, one), _mm_sub_ps(phase, one), phase)
+            : _mm_min_ps(phase, one);
+        _mm_storeu_ps(&phase_[i], phase);
+      }
+      return;
+    }
+#endif  // __SSE2__
+    for (size_t i = 0; i < n; ++i) {
+      phase_[i] += frequency_[i];
+      if (wrap) {
+        if (phase_[i] >= 1.0f) {
+          phase_[i] -= 1.0f;
+        }
+      } else {
+        phase_[i] = std::min(phase_[i], 1.0f);
+      }
+    }
+  }
+  
+  template<size_t n, bool per_channel_pw>
+  inline void AdvanceAttackReleasePhases(const float* pw, bool should_ramp_up) {
+#ifdef __SSE2__
+    if (n % 4 == 0) {
+      const __m128 half = _mm_set1_ps(0.5f);
+      const __m128 clip_at = should_ramp_up ? half : _mm_set1_ps(1.0f);
+      for (size_t i = 0; i < n; i += 4) {
+        const __m128 this_pw = per_channel_pw
+            ? _mm_loadu_ps(&pw[i])
+            : _mm_set1_ps(pw[0]);
+        __m128 phase = _mm_loadu_ps(&phase_[i]);
+        phase = should_ramp_up
+            ? Select(_mm_cmpgt_ps(phase, half), _mm_setzero_ps(), phase)
+            : Select(_mm_cmplt_ps(phase, half), half, phase);
+        const __m128 slope = Select(
+            _mm_cmplt_ps(phase, half),
+            _mm_div_ps(half, _mm_add_ps(_mm_set1_ps(1.0e-6f), this_pw)),
+            _mm_div_ps(half, _mm_sub_ps(_mm_set1_ps(1.0f + 1.0e-6f), this_pw)));
+        phase = _mm_add_ps(
+            phase, _mm_mul_ps(_mm_loadu_ps(&frequency_[i]), slope));
+        _mm_storeu_ps(&phase_[i], _mm_min_ps(phase, clip_at));
+      }
+      return;
+    }
+#endif  // __SSE2__
+    float clip_at = should_ramp_up ? 0.5f : 1.0f;
+    for (size_t i = 0; i < n; ++i) {
+      if (phase_[i] < 0.5f && !should_ramp_up) {
+        phase_[i] = 0.5f;
+      } else if (phase_[i] > 0.5f && should_ramp_up) {
+        phase_[i] = 0.0f;
+      }
+      float this_pw = per_channel_pw ? pw[i] : pw[0];
+      float slope = phase_[i] < 0.5f
+          ? 0.5f / (1.0e-6f + this_pw)
+          : 0.5f / (1.0f + 1.0e-6f - this_pw);
+      phase_[i] += frequency_[i] * slope;
+      phase_[i] = std::min(phase_[i], clip_at);
+    }
+  }
+  
+  template<size_t n>
+  inline void ComputeMultipliedPhases() {
+#ifdef __SSE2__
+    if (n % 4 == 0) {
+      const __m128 master_phase = _mm_set1_ps(master_phase_);
+      for (size_t i = 0; i < n; i += 4) {
+        __m128 wrap_counter = _mm_cvtepi32_ps(
+            _mm_loadu_si128((const __m128i*)(&wrap_counter_[i])));
+        __m128 mult_phase = _mm_add_ps(master_phase, wrap_counter);
+        mult_phase = _mm_mul_ps(mult_phase, LoadRatios(&ratio_[i]));
+        _mm_storeu_ps(&phase_[i], Fractional(mult_phase));
+      }
+      return;
+    }
+#endif  // __SSE2__
+    for (size_t i = 0; i < n; ++i) {
+      float mult_phase = master_phase_ + float(wrap_counter_[i]);
+      mult_phase *= ratio_[i].ratio;
+      MAKE_INTEGRAL_FRACTIONAL(mult_phase);
+      phase_[i] = mult_phase_fractional;
+    }
+  }
+  
   const Ratio* next_ratio_;
 
   float master_phase_;
@@ -212,8 +212,7 @@ class RampWaveshaper {
     breakpoint_ = 0.0f;
   }
   
-  template<RampMode ramp_mode>
-  inline float Shape(
+  static inline float Lookup(
       float input,
       const int16_t* shape,
       float shape_fractional) {
@@ -226,7 +225,60 @@ class RampWaveshaper {
     float y1 = static_cast<float>(shape[ws_index_integral + 1026]) / 32768.0f;
     float x = x0 + (x1 - x0) * ws_index_fractional;
     float y = y0 + (y1 - y0) * ws_index_fractional;
-    float output = x + (y - x) * shape_fractional;
+    return x + (y - x) * shape_fractional;
+  }
+  
+  // Shapes several channels at once. Only valid for the modes in which the
+  // waveshaper is stateless (everything but AR).
+  template<size_t num_channels>
+  static inline void Lookup(
+      const float* input,
+      const int16_t* shape,
+      float shape_fractional,
+      float* output) {
+#ifdef __SSE2__
+    if (num_channels % 4 == 0) {
+      const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+      const __m128 shape_amount = _mm_set1_ps(shape_fractional);
+      for (size_t j = 0; j < num_channels; j += 4) {
+        const __m128 ws_index = _mm_mul_ps(
+            _mm_set1_ps(1024.0f), _mm_loadu_ps(&input[j]));
+        const __m128i integral = _mm_cvttps_epi32(ws_index);
+        const __m128 fractional = _mm_sub_ps(
+            ws_index, _mm_cvtepi32_ps(integral));
+        int32_t i[4];
+        _mm_storeu_si128(
+            (__m128i*)(i), _mm_and_si128(integral, _mm_set1_epi32(1023)));
+      
+        const int16_t* s = shape;
+        const __m128 x0 = _mm_set_ps(s[i[3]], s[i[2]], s[i[1]], s[i[0]]);
+        s = shape + 1;
+        const __m128 x1 = _mm_set_ps(s[i[3]], s[i[2]], s[i[1]], s[i[0]]);
+        s = shape + 1025;
+        const __m128 y0 = _mm_set_ps(s[i[3]], s[i[2]], s[i[1]], s[i[0]]);
+        s = shape + 1026;
+        const __m128 y1 = _mm_set_ps(s[i[3]], s[i[2]], s[i[1]], s[i[0]]);
+      
+        const __m128 x = Interpolate(
+            _mm_mul_ps(x0, scale), _mm_mul_ps(x1, scale), fractional);
+        const __m128 y = Interpolate(
+            _mm_mul_ps(y0, scale), _mm_mul_ps(y1, scale), fractional);
+        _mm_storeu_ps(&output[j], Interpolate(x, y, shape_amount));
+      }
+      return;
+    }
+#endif  // __SSE2__
+    for (size_t i = 0; i < num_channels; ++i) {
+      output[i] = Lookup(input[i], shape, shape_fractional);
+    }
+  }
+  
+  template<RampMode ramp_mode>
+  inline float Shape(
+      float input,
+      const int16_t* shape,
+      float shape_fractional) {
+    float output = Lookup(input, shape, shape_fractional);
     
     if (ramp_mode != RAMP_MODE_AR) {
       return output;
@@ -252,6 +304,12 @@ class RampWaveshaper {
   }
   
  private:
+#ifdef __SSE2__
+  static inline __m128 Interpolate(__m128 a, __m128 b, __m128 fractional) {
+    return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), fractional));
+  }
+#endif  // __SSE2__
+  
   float previous_input_;
   float previous_output_;
   float breakpoint_;
@@ -180,6 +180,54 @@ void TestPolySlopeGenerator() {
   }
 }
 
+void TestMultiSlopeGeneratorAmplitude() {
+  // In looping mode, the ramps of all channels - including the ones with an
+  // interpolated ratio - must reach full scale once the ratios have locked.
+  const size_t kNumChannels = 8;
+  MultiSlopeGenerator<kNumChannels> multi_slope;
+  GateFlags gate_flags[kBlockSize];
+  fill(&gate_flags[0], &gate_flags[kBlockSize], GATE_FLAG_LOW);
+  
+  int failures = 0;
+  for (int ratio = 0; ratio <= 8; ++ratio) {
+    const float shift = float(ratio) / 8.0f;
+    multi_slope.Init();
+    float peak[kNumChannels];
+    fill(&peak[0], &peak[kNumChannels], -10.0f);
+    for (size_t i = 0; i < kSampleRate * 40; i += kBlockSize) {
+      MultiSlopeGenerator<kNumChannels>::OutputSample out[kBlockSize];
+      multi_slope.Render(
+          RAMP_MODE_LOOPING,
+          OUTPUT_MODE_FREQUENCY,
+          RANGE_CONTROL,
+          0.001f,
+          1.0f,  // pw
+          0.5f,  // shape
+          0.5f,  // smoothness
+          shift,
+          gate_flags,
+          NULL,
+          out,
+          kBlockSize);
+      if (i < kSampleRate * 20) {
+        continue;
+      }
+      for (size_t j = 0; j < kBlockSize; ++j) {
+        for (size_t k = 0; k < kNumChannels; ++k) {
+          peak[k] = max(peak[k], out[j].channel[k]);
+        }
+      }
+    }
+    for (size_t k = 0; k < kNumChannels; ++k) {
+      if (peak[k] < 4.9f) {
+        printf("shift %.3f channel %zu: peak %.2f V\n", shift, k, peak[k]);
+        ++failures;
+      }
+    }
+  }
+  printf("MultiSlopeGenerator amplitude: %d failures\n", failures);
+}
+
 void TestModeChangeCrash() {
   PolySlopeGenerator poly_slope_generator;
   RampMode ramp_mode = RAMP_MODE_LOOPING;
@@ -338,6 +386,7 @@ int main(void) {
   _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
   TestRampGenerator();
   TestPolySlopeGenerator();
+  TestMultiSlopeGeneratorAmplitude();
   TestModeChangeCrash();
   TestVerySlowClock();
   TestPLL();
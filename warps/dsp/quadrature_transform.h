@@ -31,89 +31,179 @@
 #define WARPS_DSP_QUADRATURE_TRANSFORM_H_
 
 #include "stmlib/stmlib.h"
+
+#include <algorithm>
+
 #include "stmlib/dsp/dsp.h"
 #include "stmlib/dsp/filter.h"
 
 namespace warps {
 
 const int32_t kMaxNumFilters = 24;
+const int32_t kMaxNumStages = kMaxNumFilters / 2;
 
-class QuadratureTransform {
+// The even-numbered allpass filters form the I chain, the odd-numbered ones
+// the Q chain. The two chains are run in lockstep: the state of each stage is
+// stored as a row of 2 * num_channels lanes (all I lanes, then all Q lanes),
+// so that the inner loops have a fixed trip count, no branches, and can be
+// vectorized across lanes and channels.
+template<size_t num_channels>
+class QuadratureTransformBank {
  public:
-  QuadratureTransform() { }
-  ~QuadratureTransform() { }
+  enum {
+    kNumLanes = 2 * num_channels
+  };
+
+  QuadratureTransformBank() { }
+  ~QuadratureTransformBank() { }
   
   void Init(const float* poles, int32_t num_filters) {
-    num_filters_ = num_filters;
-    for (int32_t i = 0; i < num_filters; ++i) {
-      filter_[i].Init(-poles[i]);
+    num_stages_ = num_filters / 2;
+    for (int32_t i = 0; i < num_stages_; ++i) {
+      Stage* s = &stage_[i];
+      for (size_t j = 0; j < num_channels; ++j) {
+        s->coefficient[0][j] = -poles[2 * i];
+        s->coefficient[1][j] = -poles[2 * i + 1];
+        s->x[0][j] = s->x[1][j] = 0.0f;
+        s->y[0][j] = s->y[1][j] = 0.0f;
+      }
+    }
+    
+    // With an odd number of filters, the I chain has one more filter than
+    // the Q chain. It is run on its own after the paired stages.
+    has_tail_ = num_filters & 1;
+    tail_coefficient_ = has_tail_ ? -poles[num_filters - 1] : 0.0f;
+    for (size_t j = 0; j < num_channels; ++j) {
+      tail_x_[j] = tail_y_[j] = 0.0f;
     }
   }
   
-  inline void Process(float in, float* i_out, float* q_out) {
-    for (int32_t i = 0; i < num_filters_; ++i) {
-      float* destination = i & 1 ? q_out : i_out;
-      float source = i <= 1 ? in : *destination;
-      *destination = filter_[i].Process(source);
+  // Processes one sample for each channel.
+  inline void Process(const float* in, float* i_out, float* q_out) {
+    float s[kNumLanes];
+    for (size_t j = 0; j < kNumLanes; ++j) {
+      s[j] = in[j % num_channels];
+    }
+    
+    for (int32_t i = 0; i < num_stages_; ++i) {
+      const float* coefficient = &stage_[i].coefficient[0][0];
+      float* x = &stage_[i].x[0][0];
+      float* y = &stage_[i].y[0][0];
+      for (size_t j = 0; j < kNumLanes; ++j) {
+        float out = coefficient[j] * (s[j] - y[j]) + x[j];
+        x[j] = s[j];
+        y[j] = out;
+        s[j] = out;
+      }
+    }
+    
+    if (has_tail_) {
+      const float coefficient = tail_coefficient_;
+      for (size_t j = 0; j < num_channels; ++j) {
+        float out = coefficient * (s[j] - tail_y_[j]) + tail_x_[j];
+        tail_x_[j] = s[j];
+        tail_y_[j] = out;
+        s[j] = out;
+      }
+    }
+    
+    for (size_t j = 0; j < num_channels; ++j) {
+      i_out[j] = s[j];
+      q_out[j] = s[j + num_channels];
     }
   }
   
-  void Process(const float* in, float* i_out, float* q_out, size_t size) {
-    for (int32_t i = 0; i < num_filters_; ++i) {
-      float* destination = i & 1 ? q_out : i_out;
-      const float* source = i <= 1 ? in : destination;
-      filter_[i].Process(source, destination, size);
-    }
+  // Single channel convenience version of the above.
+  inline void Process(float in, float* i_out, float* q_out) {
+    Process(&in, i_out, q_out);
   }
   
- private:
-  class AllPassFilter {
-   public:
-    AllPassFilter() { }
-    ~AllPassFilter() { }
-
-    void Init(float coefficient) {
-      x_ = 0.0f;
-      y_ = 0.0f;
-      coefficient_ = coefficient;
-    }
-
-    inline float Process(float in) {
-      float y = coefficient_ * (in - y_) + x_;
-      x_ = in;
-      y_ = y;
-      return y;
+  // Processes a block of size frames. in, i_out and q_out store num_channels
+  // interleaved samples per frame. The chain is processed stage by stage, and
+  // for each stage the I and Q recursions of all channels are updated in the
+  // same loop iteration.
+  void Process(const float* in, float* i_out, float* q_out, size_t size) {
+    const size_t num_samples = size * num_channels;
+    std::copy(&in[0], &in[num_samples], &i_out[0]);
+    std::copy(&in[0], &in[num_samples], &q_out[0]);
+    
+    for (int32_t i = 0; i < num_stages_; ++i) {
+      Stage* s = &stage_[i];
+      float c_i[num_channels], x_i[num_channels], y_i[num_channels];
+      float c_q[num_channels], x_q[num_channels], y_q[num_channels];
+      for (size_t j = 0; j < num_channels; ++j) {
+        c_i[j] = s->coefficient[0][j];
+        x_i[j] = s->x[0][j];
+        y_i[j] = s->y[0][j];
+        c_q[j] = s->coefficient[1][j];
+        x_q[j] = s->x[1][j];
+        y_q[j] = s->y[1][j];
+      }
+      
+      float* i_samples = i_out;
+      float* q_samples = q_out;
+      for (size_t t = 0; t < size; ++t) {
+        for (size_t j = 0; j < num_channels; ++j) {
+          const float in_i = i_samples[j];
+          const float in_q = q_samples[j];
+          y_i[j] = c_i[j] * (in_i - y_i[j]) + x_i[j];
+          y_q[j] = c_q[j] * (in_q - y_q[j]) + x_q[j];
+          x_i[j] = in_i;
+          x_q[j] = in_q;
+          i_samples[j] = y_i[j];
+          q_samples[j] = y_q[j];
+        }
+        i_samples += num_channels;
+        q_samples += num_channels;
+      }
+      
+      for (size_t j = 0; j < num_channels; ++j) {
+        s->x[0][j] = x_i[j];
+        s->y[0][j] = y_i[j];
+        s->x[1][j] = x_q[j];
+        s->y[1][j] = y_q[j];
+      }
     }
-
-    inline void Process(const float* in, float* out, size_t size) {
-      const float coefficient = coefficient_;
-      float xp = x_;
-      float yp = y_;
-      while (size--) {
-        float x = *in++;
-        float y = coefficient * (x - yp) + xp;
-        *out++ = y;
-        xp = x;
-        yp = y;
+    
+    if (has_tail_) {
+      const float coefficient = tail_coefficient_;
+      float x[num_channels], y[num_channels];
+      std::copy(&tail_x_[0], &tail_x_[num_channels], &x[0]);
+      std::copy(&tail_y_[0], &tail_y_[num_channels], &y[0]);
+      float* i_samples = i_out;
+      for (size_t t = 0; t < size; ++t) {
+        for (size_t j = 0; j < num_channels; ++j) {
+          const float in_i = i_samples[j];
+          y[j] = coefficient * (in_i - y[j]) + x[j];
+          x[j] = in_i;
+          i_samples[j] = y[j];
+        }
+        i_samples += num_channels;
       }
-      x_ = xp;
-      y_ = yp;
+      std::copy(&x[0], &x[num_channels], &tail_x_[0]);
+      std::copy(&y[0], &y[num_channels], &tail_y_[0]);
     }
-
-   private:
-    float x_;
-    float y_;
-    float coefficient_;
-
-    DISALLOW_COPY_AND_ASSIGN(AllPassFilter);
+  }
+  
+ private:
+  struct Stage {
+    float coefficient[2][num_channels];
+    float x[2][num_channels];
+    float y[2][num_channels];
   };
+  
+  Stage stage_[kMaxNumStages];
+  float tail_x_[num_channels];
+  float tail_y_[num_channels];
+  float tail_coefficient_;
+  int32_t num_stages_;
+  bool has_tail_;
 
-  AllPassFilter filter_[kMaxNumFilters];
-  int32_t num_filters_;
-
-  DISALLOW_COPY_AND_ASSIGN(QuadratureTransform);
+  DISALLOW_COPY_AND_ASSIGN(QuadratureTransformBank);
 };
 
+typedef QuadratureTransformBank<1> QuadratureTransform;
+
 }  // namespace warps
 
 #endif  // WARPS_DSP_QUADRATURE_TRANSFORM_H_
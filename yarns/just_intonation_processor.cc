@@ -70,7 +70,118 @@ int JustIntonationProcessor::Tune(int note, int min, int max, int step) {
   return best_correction;
 }
 
+const int32_t kHeldWeight = 255;
+const int32_t kReleasedWeight = 192;
+
+// The gain applied to released_score_ is a 16-bit fraction. Below 1/16, the
+// sums are rescaled so that the weights added by NoteOff stay small enough
+// for the sums not to overflow.
+const int32_t kUnityGain = 65536;
+const int32_t kMinReleasedGain = kUnityGain >> 4;
+
+void IncrementalJustIntonationProcessor::Init() {
+  cached_note_ = 0xff;
+  cached_pitch_ = 0;
+  num_held_notes_ = 0;
+  released_gain_ = kUnityGain;
+  std::fill(&held_score_[0], &held_score_[kOctave], 0);
+  std::fill(&released_score_[0], &released_score_[kOctave], 0);
+}
+
+void IncrementalJustIntonationProcessor::Accumulate(
+    int32_t* score,
+    int16_t pitch,
+    int32_t weight) {
+  // score[i] += weight * lut_consonance[(i - pitch) % kOctave], with the
+  // modulo taken out of the loops.
+  int offset = (kOctave * 12 - pitch) % kOctave;
+  int wrap = kOctave - offset;
+  for (int i = 0; i < wrap; ++i) {
+    score[i] += weight * lut_consonance[i + offset];
+  }
+  for (int i = wrap; i < kOctave; ++i) {
+    score[i] += weight * lut_consonance[i - wrap];
+  }
+}
+
+void IncrementalJustIntonationProcessor::Remove(uint8_t index) {
+  --num_held_notes_;
+  std::copy(
+      &held_notes_[index + 1],
+      &held_notes_[num_held_notes_ + 1],
+      &held_notes_[index]);
+}
+
+void IncrementalJustIntonationProcessor::NoteOff(uint8_t note) {
+  uint8_t i = 0;
+  while (i < num_held_notes_) {
+    if (held_notes_[i].note == note) {
+      Accumulate(held_score_, held_notes_[i].pitch, -kHeldWeight);
+      Accumulate(
+          released_score_,
+          held_notes_[i].pitch,
+          kReleasedWeight * kUnityGain / released_gain_);
+      Remove(i);
+    } else {
+      ++i;
+    }
+  }
+}
+
+int16_t IncrementalJustIntonationProcessor::NoteOn(uint8_t note) {
+  if (note != cached_note_) {
+    cached_note_ = note;
+    cached_pitch_ = Tune(static_cast<int>(note) << 7);
+  }
+  
+  // Decay the weight of all the released notes. Only the gain is updated;
+  // the sums are scaled by it when they are read.
+  released_gain_ = (released_gain_ * 3) >> 2;
+  if (released_gain_ < kMinReleasedGain) {
+    for (int i = 0; i < kOctave; ++i) {
+      released_score_[i] = ReleasedScore(i);
+    }
+    released_gain_ = kUnityGain;
+  }
+  
+  // When too many notes are held, the oldest one is forgotten.
+  if (num_held_notes_ == kMaxHeldNotes) {
+    Accumulate(held_score_, held_notes_[0].pitch, -kHeldWeight);
+    Remove(0);
+  }
+  HistoryEntry* e = &held_notes_[num_held_notes_++];
+  e->note = note;
+  e->weight = kHeldWeight;
+  e->pitch = cached_pitch_;
+  Accumulate(held_score_, cached_pitch_, kHeldWeight);
+  return cached_pitch_;
+}
+
+int IncrementalJustIntonationProcessor::Tune(
+    int note,
+    int min,
+    int max,
+    int step) {
+  int best_score = 0x7fffffff;
+  int best_correction = 0;
+  for (int correction = min; correction <= max; correction += step) {
+    int pitch = (correction + note + kOctave * 12) % kOctave;
+    int score = lut_consonance[
+        correction >= 0 ? correction : (kOctave + correction)];
+    score += held_score_[pitch] + ReleasedScore(pitch);
+    if (score < best_score) {
+      best_correction = correction;
+      best_score = score;
+    }
+  }
+  return best_correction;
+}
+
 /* extern */
+#ifdef YARNS_INCREMENTAL_JUST_INTONATION
+IncrementalJustIntonationProcessor just_intonation_processor;
+#else
 JustIntonationProcessor just_intonation_processor;
+#endif  // YARNS_INCREMENTAL_JUST_INTONATION
 
 }  // namespace yarns
\ No newline at end of file
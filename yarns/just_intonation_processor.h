@@ -41,6 +41,16 @@
 // interval involves more convoluted ratios (say 32/27), and goes up according
 // to a square law as we move away from the just intervals.
 // The tuning giving the least badness score is selected.
+//
+// IncrementalJustIntonationProcessor is a host-side variant, selected with
+// YARNS_INCREMENTAL_JUST_INTONATION, for dense material and long histories.
+// Rather than rescoring each candidate against the whole history, it keeps
+// for each pitch of the octave the weighted sum of dissonance scores with the
+// notes still held, and with all the released notes. Scoring a candidate is
+// then a lookup. Since all the released notes decay at the same rate, their
+// sums share a single gain, which is decayed instead of the sums, so that
+// the released notes never need to be dropped from the history. The price
+// is 12kb of RAM.
 
 #ifndef YARNS_JUST_INTONATION_PROCESSOR_H_
 #define YARNS_JUST_INTONATION_PROCESSOR_H_
@@ -111,7 +121,53 @@ class JustIntonationProcessor {
   DISALLOW_COPY_AND_ASSIGN(JustIntonationProcessor);
 };
 
+const size_t kMaxHeldNotes = 64;
+
+class IncrementalJustIntonationProcessor {
+ public:
+  IncrementalJustIntonationProcessor() { }
+  ~IncrementalJustIntonationProcessor() { }
+  
+  void Init();
+  void NoteOff(uint8_t note);
+  int16_t NoteOn(uint8_t note);
+  
+ private:
+  int Tune(int note, int min, int max, int steps);
+  
+  int16_t Tune(int note) {
+    int coarse = Tune(note, -32, 32, 4);
+    return int16_t(note + Tune(note, coarse - 6, coarse + 6, 1));
+  }
+  
+  // Adds the dissonance scores with pitch, scaled by weight, to the sums.
+  void Accumulate(int32_t* score, int16_t pitch, int32_t weight);
+  void Remove(uint8_t index);
+  
+  inline int32_t ReleasedScore(int pitch) const {
+    return static_cast<int32_t>(
+        (static_cast<int64_t>(released_score_[pitch]) * released_gain_) >> 16);
+  }
+  
+  int16_t cached_pitch_;
+  uint8_t cached_note_;
+  
+  // Held notes, from the oldest to the most recent.
+  uint8_t num_held_notes_;
+  HistoryEntry held_notes_[kMaxHeldNotes];
+  
+  int32_t held_score_[12 << 7];
+  int32_t released_score_[12 << 7];
+  int32_t released_gain_;
+  
+  DISALLOW_COPY_AND_ASSIGN(IncrementalJustIntonationProcessor);
+};
+
+#ifdef YARNS_INCREMENTAL_JUST_INTONATION
+extern IncrementalJustIntonationProcessor just_intonation_processor;
+#else
 extern JustIntonationProcessor just_intonation_processor;
+#endif  // YARNS_INCREMENTAL_JUST_INTONATION
 
 }  // namespace yarns
 
@@ -0,0 +1,112 @@
+// Copyright 2013 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Timestamped MIDI events, passed from a MIDI input thread to the audio thread
+// of a host.
+//
+// Single producer, single consumer: the producer only writes the write index,
+// the consumer only writes the read index, so no lock is needed. The producer
+// must push the events in timestamp order.
+
+#ifndef YARNS_MIDI_EVENT_QUEUE_H_
+#define YARNS_MIDI_EVENT_QUEUE_H_
+
+#include "stmlib/stmlib.h"
+
+namespace yarns {
+
+const size_t kMidiEventQueueSize = 256;
+
+struct MidiEvent {
+  uint32_t timestamp;  // In samples, in the timebase of Multi::Render.
+  uint8_t size;  // 1 to 3 bytes.
+  uint8_t data[3];
+};
+
+class MidiEventQueue {
+ public:
+  MidiEventQueue() { }
+  ~MidiEventQueue() { }
+
+  inline void Init() {
+    read_ptr_ = 0;
+    write_ptr_ = 0;
+  }
+
+  inline size_t readable() const {
+    return static_cast<size_t>(write_ptr_ - read_ptr_);
+  }
+
+  inline size_t writable() const {
+    return kMidiEventQueueSize - readable();
+  }
+
+  // Producer side. Returns false when the queue is full: the event is dropped
+  // rather than overwriting one that the consumer might be reading.
+  inline bool Push(const MidiEvent& event) {
+    const uint32_t w = write_ptr_;
+    if (w - read_ptr_ >= kMidiEventQueueSize) {
+      return false;
+    }
+    buffer_[w & kMask] = event;
+    // Make sure the event is visible before the new write index.
+    __sync_synchronize();
+    write_ptr_ = w + 1;
+    return true;
+  }
+
+  // Consumer side. Only valid when readable() is non-zero.
+  inline const MidiEvent& Peek() const {
+    // Make sure the event is not read before the write index.
+    __sync_synchronize();
+    return buffer_[read_ptr_ & kMask];
+  }
+
+  inline void Pop() {
+    __sync_synchronize();
+    read_ptr_ = read_ptr_ + 1;
+  }
+
+  // Consumer side. Drops all the events currently in the queue.
+  inline void Flush() {
+    read_ptr_ = write_ptr_;
+  }
+
+ private:
+  enum {
+    kMask = kMidiEventQueueSize - 1
+  };
+
+  MidiEvent buffer_[kMidiEventQueueSize];
+  volatile uint32_t read_ptr_;
+  volatile uint32_t write_ptr_;
+
+  DISALLOW_COPY_AND_ASSIGN(MidiEventQueue);
+};
+
+}  // namespace yarns
+
+#endif // YARNS_MIDI_EVENT_QUEUE_H_
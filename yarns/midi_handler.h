@@ -34,6 +34,7 @@
 #include "stmlib/utils/ring_buffer.h"
 #include "stmlib/midi/midi.h"
 
+#include "yarns/midi_event_queue.h"
 #include "yarns/multi.h"
 
 namespace yarns {
@@ -191,6 +192,14 @@ class MidiHandler {
     }
   }
   
+  // Host-side counterpart of PushByte/ProcessInput, for events which are
+  // dispatched at their own time by Multi::Render.
+  static void ProcessEvent(const MidiEvent& event) {
+    for (uint8_t i = 0; i < event.size; ++i) {
+      parser_.PushByte(event.data[i]);
+    }
+  }
+  
   static inline MidiBuffer* mutable_output_buffer() { return &output_buffer_; }
   static inline SmallMidiBuffer* mutable_high_priority_output_buffer() {
     return &high_priority_output_buffer_;
@@ -56,7 +56,10 @@ void Multi::Init(bool reset_calibration) {
   for (uint8_t i = 0; i < kNumParts; ++i) {
     part_[i].Init();
     part_[i].set_custom_pitch_table(settings_.custom_pitch_table);
+    part_[i].set_routing_dirty_flag(&routing_dirty_);
   }
+  custom_num_parts_ = 0;
+  routing_dirty_ = true;
   for (uint8_t i = 0; i < kNumVoices; ++i) {
     voice_[i].Init(reset_calibration);
   }
@@ -64,6 +67,11 @@ void Multi::Init(bool reset_calibration) {
   latched_ = false;
   recording_ = false;
   
+  refresh_counter_ = 1;
+  fill(&cv_[0], &cv_[kNumCVOutputs], 0);
+  fill(&gate_[0], &gate_[kNumCVOutputs], false);
+  fill(&audio_source_[0], &audio_source_[kNumCVOutputs], 0xff);
+  
   // Put the multi in a usable state. Even if these settings will later be
   // overridden with some data retrieved from Flash (presets).
   settings_.clock_tempo = 120;
@@ -273,6 +281,13 @@ void Multi::Stop() {
 }
 
 void Multi::Refresh() {
+  RefreshClock();
+  for (uint8_t i = 0; i < kNumVoices; ++i) {
+    voice_[i].Refresh();
+  }
+}
+
+void Multi::RefreshClock() {
   if (clock_pulse_counter_) {
     --clock_pulse_counter_;
   }
@@ -291,9 +306,147 @@ void Multi::Refresh() {
       --swing_predelay_[i];
     }
   }
+}
+
+void Multi::Render(
+    MidiEventQueue* queue,
+    uint32_t timestamp,
+    uint16_t* cv,
+    bool* gate,
+    size_t size) {
+  uint16_t* run_cv = cv;
+  size_t run_size = 0;
+  for (size_t i = 0; i < size; ++i) {
+    const uint32_t now = timestamp + i;
+    RefreshInternalClock();
+    
+    bool has_events = queue->readable() && \
+        static_cast<int32_t>(queue->Peek().timestamp - now) <= 0;
+    bool refresh = --refresh_counter_ == 0;
+    if (has_events || internal_clock_ticks_ || refresh) {
+      // The state is about to change: the audio up to this sample is rendered
+      // with the previous one.
+      RenderAudioRun(run_cv, run_size);
+      run_cv = cv;
+      run_size = 0;
+      
+      while (has_events) {
+        midi_handler.ProcessEvent(queue->Peek());
+        queue->Pop();
+        has_events = queue->readable() && \
+            static_cast<int32_t>(queue->Peek().timestamp - now) <= 0;
+      }
+      ProcessInternalClockEvents();
+      if (refresh) {
+        Refresh();
+        refresh_counter_ = kRefreshPeriod;
+      }
+      GetCvGate(cv_, gate_);
+      GetAudioSource(audio_source_);
+    }
+    
+    copy(&cv_[0], &cv_[kNumCVOutputs], cv);
+    copy(&gate_[0], &gate_[kNumCVOutputs], gate);
+    cv += kNumCVOutputs;
+    gate += kNumCVOutputs;
+    ++run_size;
+  }
+  RenderAudioRun(run_cv, run_size);
+}
+
+void Multi::RenderVoices(
+    MidiEventQueue* queue,
+    uint32_t timestamp,
+    uint16_t* note_cv,
+    bool* gate,
+    uint16_t* audio,
+    size_t size) {
+  size_t run_start = 0;
+  uint8_t run_refresh_counter = refresh_counter_;
+  for (size_t i = 0; i < size; ++i) {
+    const uint32_t now = timestamp + i;
+    RefreshInternalClock();
+    
+    bool has_events = queue->readable() && \
+        static_cast<int32_t>(queue->Peek().timestamp - now) <= 0;
+    uint8_t refresh_counter = refresh_counter_;
+    bool refresh = --refresh_counter_ == 0;
+    if (refresh) {
+      refresh_counter_ = kRefreshPeriod;
+    }
+    
+    // Unless the parts are about to change the state of the voices, the
+    // voices keep rendering their run.
+    if (has_events || internal_clock_ticks_ || (refresh && clock_due())) {
+      RenderVoicesRun(
+          run_refresh_counter,
+          run_start,
+          i - run_start,
+          note_cv,
+          gate,
+          audio,
+          size);
+      run_start = i;
+      run_refresh_counter = refresh_counter;
+      
+      while (has_events) {
+        midi_handler.ProcessEvent(queue->Peek());
+        queue->Pop();
+        has_events = queue->readable() && \
+            static_cast<int32_t>(queue->Peek().timestamp - now) <= 0;
+      }
+      ProcessInternalClockEvents();
+    }
+    if (refresh) {
+      RefreshClock();
+    }
+  }
+  RenderVoicesRun(
+      run_refresh_counter,
+      run_start,
+      size - run_start,
+      note_cv,
+      gate,
+      audio,
+      size);
+}
 
+void Multi::RenderVoicesRun(
+    uint8_t refresh_counter,
+    size_t start,
+    size_t size,
+    uint16_t* note_cv,
+    bool* gate,
+    uint16_t* audio,
+    size_t stride) {
+  if (!size) {
+    return;
+  }
   for (uint8_t i = 0; i < kNumVoices; ++i) {
-    voice_[i].Refresh();
+    const size_t offset = i * stride + start;
+    voice_[i].Render(
+        refresh_counter,
+        note_cv ? note_cv + offset : NULL,
+        gate ? gate + offset : NULL,
+        audio ? audio + offset : NULL,
+        size);
+  }
+}
+
+void Multi::RenderAudioRun(uint16_t* cv, size_t size) {
+  if (!size) {
+    return;
+  }
+  for (uint8_t i = 0; i < kNumCVOutputs; ++i) {
+    uint8_t source = audio_source_[i];
+    if (source == 0xff) {
+      continue;
+    }
+    Voice* voice = &voice_[source];
+    voice->RenderAudio(size);
+    for (size_t j = 0; j < size; ++j) {
+      cv[j * kNumCVOutputs + i] = voice->ReadSample();
+    }
   }
 }
 
@@ -507,6 +660,18 @@ void Multi::UpdateLayout() {
   for (uint8_t i = 0; i < kNumVoices; ++i) {
     voice_[i].NoteOff();
   }
+  routing_dirty_ = true;
+  
+  if (custom_num_parts_) {
+    Voice* voice = &voice_[0];
+    for (uint8_t i = 0; i < custom_num_parts_; ++i) {
+      part_[i].AllocateVoices(voice, custom_num_voices_[i], false);
+      part_[i].set_siblings(custom_num_parts_ > 1);
+      voice += custom_num_voices_[i];
+    }
+    num_active_parts_ = custom_num_parts_;
+    return;
+  }
   
   switch (settings_.layout) {
     case LAYOUT_MONO:
@@ -570,6 +735,8 @@ void Multi::ChangeLayout(Layout old_layout, Layout new_layout) {
   for (uint8_t i = 0; i < kNumVoices; ++i) {
     voice_[i].NoteOff();
   }
+  custom_num_parts_ = 0;
+  routing_dirty_ = true;
   
   switch (new_layout) {
     case LAYOUT_MONO:
@@ -778,6 +945,27 @@ void Multi::ChangeLayout(Layout old_layout, Layout new_layout) {
   }
 }
 
+void Multi::SetCustomLayout(uint8_t num_parts, const uint8_t* num_voices) {
+  uint8_t total = 0;
+  custom_num_parts_ = 0;
+  for (uint8_t i = 0; i < num_parts && i < kNumParts; ++i) {
+    uint8_t n = num_voices[i];
+    if (n > kMaxNumVoices) {
+      n = kMaxNumVoices;
+    }
+    if (total + n > kNumVoices) {
+      n = kNumVoices - total;
+    }
+    if (!n) {
+      break;
+    }
+    custom_num_voices_[i] = n;
+    total += n;
+    ++custom_num_parts_;
+  }
+  UpdateLayout();
+}
+
 void Multi::Touch() {
   Stop();
 
@@ -847,11 +1035,19 @@ bool Multi::ControlChange(uint8_t channel, uint8_t controller, uint8_t value) {
     }
   }
   
-  for (uint8_t i = 0; i < num_active_parts_; ++i) {
-    if (part_[i].accepts(channel) && \
-        channel + 1 != settings_.remote_control_channel) {
-      thru = part_[i].ControlChange(channel, controller, value) && thru;
-      yarns::settings.SetFromCC(i, controller, value);
+  if (channel + 1 == settings_.remote_control_channel) {
+    return thru;
+  }
+  
+  PartMask parts = routing_table().parts(channel);
+  while (parts) {
+    uint8_t i = RoutingTable::Next(&parts);
+    thru = part_[i].ControlChange(channel, controller, value) && thru;
+    yarns::settings.SetFromCC(i, controller, value);
+    if (routing_dirty_) {
+      // The CC has changed the MIDI settings or the layout. Dispatch it to the
+      // remaining parts according to the new settings.
+      parts = routing_table().parts(channel) & ~((PartMask(2) << i) - 1);
     }
   }
   return thru;
@@ -33,15 +33,19 @@
 
 #include "yarns/internal_clock.h"
 #include "yarns/layout_configurator.h"
+#include "yarns/midi_event_queue.h"
 #include "yarns/part.h"
+#include "yarns/routing_table.h"
 #include "yarns/voice.h"
 
 namespace yarns {
 
-const uint8_t kNumParts = 4;
-const uint8_t kNumVoices = 4;
+const uint8_t kNumParts = YARNS_NUM_PARTS;
+const uint8_t kNumVoices = YARNS_NUM_VOICES;
 const uint8_t kMaxBarDuration = 32;
 
+const uint8_t kNumCVOutputs = 4;
+
 struct MultiSettings {
   uint8_t layout;
   uint8_t clock_tempo;
@@ -115,12 +119,11 @@ class Multi {
     layout_configurator_.RegisterNote(channel, note);
 
     bool thru = true;
-    bool received = false;
-    for (uint8_t i = 0; i < num_active_parts_; ++i) {
-      if (part_[i].accepts(channel, note, velocity)) {
-        received = true;
-        thru = part_[i].NoteOn(channel, note, velocity) && thru;
-      }
+    PartMask parts = routing_table().parts(channel, note, velocity);
+    bool received = parts != 0;
+    while (parts) {
+      uint8_t i = RoutingTable::Next(&parts);
+      thru = part_[i].NoteOn(channel, note, velocity) && thru;
     }
     
     if (received &&
@@ -138,15 +141,13 @@ class Multi {
   
   bool NoteOff(uint8_t channel, uint8_t note, uint8_t velocity) {
     bool thru = true;
-    bool has_notes = false;
-    for (uint8_t i = 0; i < num_active_parts_; ++i) {
-      if (part_[i].accepts(channel, note)) {
-        thru = part_[i].NoteOff(channel, note) && thru;
-      }
-      has_notes = has_notes || part_[i].has_notes();
+    PartMask parts = routing_table().parts(channel, note);
+    while (parts) {
+      uint8_t i = RoutingTable::Next(&parts);
+      thru = part_[i].NoteOff(channel, note) && thru;
     }
     
-    if (!has_notes && internal_clock() && started_by_keyboard_) {
+    if (internal_clock() && started_by_keyboard_ && !has_notes()) {
       stop_count_down_ = 12;
     }
     
@@ -157,30 +158,30 @@ class Multi {
 
   bool PitchBend(uint8_t channel, uint16_t pitch_bend) {
     bool thru = true;
-    for (uint8_t i = 0; i < num_active_parts_; ++i) {
-      if (part_[i].accepts(channel)) {
-        thru = part_[i].PitchBend(channel, pitch_bend) && thru;
-      }
+    PartMask parts = routing_table().parts(channel);
+    while (parts) {
+      uint8_t i = RoutingTable::Next(&parts);
+      thru = part_[i].PitchBend(channel, pitch_bend) && thru;
     }
     return thru;
   }
 
   bool Aftertouch(uint8_t channel, uint8_t note, uint8_t velocity) {
     bool thru = true;
-    for (uint8_t i = 0; i < num_active_parts_; ++i) {
-      if (part_[i].accepts(channel, note)) {
-        thru = part_[i].Aftertouch(channel, note, velocity) && thru;
-      }
+    PartMask parts = routing_table().parts(channel, note);
+    while (parts) {
+      uint8_t i = RoutingTable::Next(&parts);
+      thru = part_[i].Aftertouch(channel, note, velocity) && thru;
     }
     return thru;
   }
 
   bool Aftertouch(uint8_t channel, uint8_t velocity) {
     bool thru = true;
-    for (uint8_t i = 0; i < num_active_parts_; ++i) {
-      if (part_[i].accepts(channel)) {
-        thru = part_[i].Aftertouch(channel, velocity) && thru;
-      }
+    PartMask parts = routing_table().parts(channel);
+    while (parts) {
+      uint8_t i = RoutingTable::Next(&parts);
+      thru = part_[i].Aftertouch(channel, velocity) && thru;
     }
     return thru;
   }
@@ -193,6 +194,11 @@ class Multi {
   
   void Clock();
   
+  // Host-side alternative to the layouts of the module: splits the voices
+  // into num_parts parts, part i playing the next num_voices[i] voices. The
+  // layout of the settings is restored when num_parts is 0.
+  void SetCustomLayout(uint8_t num_parts, const uint8_t* num_voices);
+  
   // A start initiated by a MIDI 0xfa event or the front panel start button will
   // start the sequencers. A start initiated by the keyboard will not start
   // the sequencers, and give priority to the arpeggiator. This allows the
@@ -305,6 +311,43 @@ class Multi {
     }
   }
   
+  // Host-side replacement for the interrupts and main loop of the module,
+  // running at 48kHz. Renders size samples starting at sample time timestamp,
+  // writing for each of them the kNumCVOutputs DAC codes and gates of the
+  // module (interleaved). The events of the queue are dispatched at their exact
+  // sample, the voices rendering audio up to it with the previous state.
+  void Render(
+      MidiEventQueue* queue,
+      uint32_t timestamp,
+      uint16_t* cv,
+      bool* gate,
+      size_t size);
+  
+  // Host-side rendering of all the voices, one after the other: for voice i,
+  // the size samples of note CV, gate and audio (any of them can be NULL) are
+  // written at note_cv + i * size, gate + i * size and audio + i * size. The
+  // voices are only interrupted by the events and clock ticks changing their
+  // state, rather than on every refresh.
+  void RenderVoices(
+      MidiEventQueue* queue,
+      uint32_t timestamp,
+      uint16_t* note_cv,
+      bool* gate,
+      uint16_t* audio,
+      size_t size);
+  
+  // Host-side, faster than real time rendering of a sample of the clock, song,
+  // sequencers and arpeggiators, in the same order as Multi::Render but
+  // without refreshing the voices.
+  inline void RenderClock() {
+    RefreshInternalClock();
+    ProcessInternalClockEvents();
+    if (--refresh_counter_ == 0) {
+      RefreshClock();
+      refresh_counter_ = kRefreshPeriod;
+    }
+  }
+  
   void Set(uint8_t address, uint8_t value);
   inline uint8_t Get(uint8_t address) const {
     const uint8_t* bytes;
@@ -424,6 +467,45 @@ class Multi {
   void ClockSong();
   void HandleRemoteControlCC(uint8_t controller, uint8_t value);
   
+  inline bool has_notes() const {
+    for (uint8_t i = 0; i < num_active_parts_; ++i) {
+      if (part_[i].has_notes()) {
+        return true;
+      }
+    }
+    return false;
+  }
+  
+  inline const RoutingTable& routing_table() {
+    if (routing_dirty_) {
+      routing_table_.Rebuild(part_, num_active_parts_);
+      routing_dirty_ = false;
+    }
+    return routing_table_;
+  }
+  void RenderAudioRun(uint16_t* cv, size_t size);
+  void RenderVoicesRun(
+      uint8_t refresh_counter,
+      size_t start,
+      size_t size,
+      uint16_t* note_cv,
+      bool* gate,
+      uint16_t* audio,
+      size_t stride);
+  
+  // Control rate update of the clocks, without the voices.
+  void RefreshClock();
+  
+  // Whether the next refresh will clock the parts (a swung tick is due).
+  inline bool clock_due() const {
+    for (uint8_t i = 0; i < 12; ++i) {
+      if (swing_predelay_[i] == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+  
   MultiSettings settings_;
   
   bool running_;
@@ -434,6 +516,12 @@ class Multi {
   InternalClock internal_clock_;
   uint8_t internal_clock_ticks_;
   uint16_t midi_clock_tick_duration_;
+  
+  // State of the host-side rendering.
+  uint8_t refresh_counter_;
+  uint16_t cv_[kNumCVOutputs];
+  bool gate_[kNumCVOutputs];
+  uint8_t audio_source_[kNumCVOutputs];
 
   int16_t swing_predelay_[12];
   uint8_t swing_counter_;
@@ -455,6 +543,13 @@ class Multi {
   
   uint8_t num_active_parts_;
   
+  // Voice split set by SetCustomLayout, overriding the layout when non-zero.
+  uint8_t custom_num_parts_;
+  uint8_t custom_num_voices_[kNumParts];
+  
+  RoutingTable routing_table_;
+  bool routing_dirty_;
+  
   Part part_[kNumParts];
   Voice voice_[kNumVoices];
 
@@ -64,6 +64,7 @@ void Part::Init() {
   seq_running_ = false;
   release_latched_keys_on_next_note_on_ = false;
   transposable_ = true;
+  routing_dirty_ = NULL;
 }
   
 void Part::AllocateVoices(Voice* voice, uint8_t num_voices, bool polychain) {
@@ -140,10 +141,12 @@ bool Part::ControlChange(uint8_t channel, uint8_t controller, uint8_t value) {
       
     case kCCOmniModeOff:
       midi_.channel = channel;
+      TouchRouting();
       break;
       
     case kCCOmniModeOn:
       midi_.channel = 0x10;
+      TouchRouting();
       break;
       
     case kCCMonoModeOn:
@@ -304,6 +307,7 @@ void Part::StartRecording() {
     return;
   }
   seq_recording_ = true;
+  TouchRouting();
   seq_rec_step_ = 0;
   seq_overdubbing_ = seq_.num_steps && seq_running_;
   if (!seq_overdubbing_) {
@@ -681,6 +685,7 @@ void Part::Set(uint8_t address, uint8_t value) {
         // Shut all channels off when a MIDI parameter is changed to prevent
         // stuck notes.
         AllNotesOff();
+        TouchRouting();
         break;
         
       case PART_VOICING_ALLOCATION_MODE:
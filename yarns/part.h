@@ -32,15 +32,26 @@
 #include <algorithm>
 
 #include "stmlib/stmlib.h"
-#include "stmlib/algorithms/voice_allocator.h"
 #include "stmlib/algorithms/note_stack.h"
 
+#include "yarns/voice_allocator.h"
+
 namespace yarns {
 
 class Voice;
 
+// The module has 4 parts and 4 voices. Host builds can raise these limits to
+// drive larger multitimbral or MPE setups, up to 32 parts and 64 voices.
+#ifndef YARNS_NUM_PARTS
+#define YARNS_NUM_PARTS 4
+#endif  // YARNS_NUM_PARTS
+
+#ifndef YARNS_NUM_VOICES
+#define YARNS_NUM_VOICES 4
+#endif  // YARNS_NUM_VOICES
+
 const uint8_t kNumSteps = 64;
-const uint8_t kMaxNumVoices = 4;
+const uint8_t kMaxNumVoices = YARNS_NUM_VOICES;
 
 enum ArpeggiatorDirection {
   ARPEGGIATOR_DIRECTION_UP,
@@ -240,6 +251,7 @@ class Part {
   void Stop();
   void StopRecording() {
     seq_recording_ = false;
+    TouchRouting();
   }
   void StartRecording();
   
@@ -278,9 +290,14 @@ class Part {
   }
   
   inline bool accepts(uint8_t channel, uint8_t note) const {
-    if (!accepts(channel)) {
-      return false;
-    }
+    return accepts(channel) && accepts_note(note);
+  }
+  
+  inline bool accepts(uint8_t channel, uint8_t note, uint8_t velocity) const {
+    return accepts(channel, note) && accepts_velocity(velocity);
+  }
+  
+  inline bool accepts_note(uint8_t note) const {
     if (midi_.min_note <= midi_.max_note) {
       return note >= midi_.min_note && note <= midi_.max_note;
     } else {
@@ -288,10 +305,8 @@ class Part {
     }
   }
   
-  inline bool accepts(uint8_t channel, uint8_t note, uint8_t velocity) const {
-    return accepts(channel, note) && \
-        velocity >= midi_.min_velocity && \
-        velocity <= midi_.max_velocity;
+  inline bool accepts_velocity(uint8_t velocity) const {
+    return velocity >= midi_.min_velocity && velocity <= midi_.max_velocity;
   }
   
   void AllocateVoices(Voice* voice, uint8_t num_voices, bool polychain);
@@ -357,10 +372,22 @@ class Part {
   
   void set_transposable(bool transposable) {
     transposable_ = transposable;
+    TouchRouting();
+  }
+  
+  // The flag is raised whenever a change to this part invalidates the
+  // routing table of the multi.
+  inline void set_routing_dirty_flag(bool* routing_dirty) {
+    routing_dirty_ = routing_dirty;
   }
   
  private:
   int16_t Tune(int16_t note);
+  inline void TouchRouting() {
+    if (routing_dirty_) {
+      *routing_dirty_ = true;
+    }
+  }
   void ResetAllControllers();
   void TouchVoiceAllocation();
   void TouchVoices();
@@ -381,6 +408,7 @@ class Part {
   
   Voice* voice_[kMaxNumVoices];
   int8_t* custom_pitch_table_;
+  bool* routing_dirty_;
   uint8_t num_voices_;
   bool polychained_;
   
@@ -390,7 +418,7 @@ class Part {
   stmlib::NoteStack<12> pressed_keys_;
   stmlib::NoteStack<12> generated_notes_;  // by sequencer or arpeggiator.
   stmlib::NoteStack<12> mono_allocator_;
-  stmlib::VoiceAllocator<kMaxNumVoices * 2> poly_allocator_;
+  VoiceAllocator<kMaxNumVoices * 2> poly_allocator_;
   uint8_t active_note_[kMaxNumVoices];
   uint8_t cyclic_allocation_note_counter_;
   
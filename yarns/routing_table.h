@@ -0,0 +1,113 @@
+// Copyright 2013 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Routing of the MIDI messages to the parts.
+//
+// Each entry is the set of parts accepting a channel, note or velocity, so the
+// parts receiving a message are found with two ANDs instead of testing each
+// part in turn. The table has to be rebuilt whenever the MIDI settings, the
+// recording state or the number of active parts change.
+
+#ifndef YARNS_ROUTING_TABLE_H_
+#define YARNS_ROUTING_TABLE_H_
+
+#include <algorithm>
+
+#include "stmlib/stmlib.h"
+
+#include "yarns/part.h"
+
+namespace yarns {
+
+#if YARNS_NUM_PARTS <= 8
+typedef uint8_t PartMask;
+#elif YARNS_NUM_PARTS <= 16
+typedef uint16_t PartMask;
+#elif YARNS_NUM_PARTS <= 32
+typedef uint32_t PartMask;
+#else
+#error "No more than 32 parts can be routed."
+#endif  // YARNS_NUM_PARTS
+
+class RoutingTable {
+ public:
+  RoutingTable() { }
+  ~RoutingTable() { }
+  
+  void Rebuild(const Part* part, uint8_t num_parts) {
+    std::fill(&channel_[0], &channel_[16], 0);
+    std::fill(&note_[0], &note_[128], 0);
+    std::fill(&velocity_[0], &velocity_[128], 0);
+    for (uint8_t i = 0; i < num_parts; ++i) {
+      const PartMask mask = static_cast<PartMask>(1) << i;
+      for (uint8_t j = 0; j < 16; ++j) {
+        if (part[i].accepts(j)) {
+          channel_[j] |= mask;
+        }
+      }
+      for (uint8_t j = 0; j < 128; ++j) {
+        if (part[i].accepts_note(j)) {
+          note_[j] |= mask;
+        }
+        if (part[i].accepts_velocity(j)) {
+          velocity_[j] |= mask;
+        }
+      }
+    }
+  }
+  
+  inline PartMask parts(uint8_t channel) const {
+    return channel_[channel & 0xf];
+  }
+  
+  inline PartMask parts(uint8_t channel, uint8_t note) const {
+    return channel_[channel & 0xf] & note_[note & 0x7f];
+  }
+  
+  inline PartMask parts(uint8_t channel, uint8_t note, uint8_t velocity) const {
+    return channel_[channel & 0xf] & note_[note & 0x7f] & \
+        velocity_[velocity & 0x7f];
+  }
+  
+  // Returns the index of the lowest part in the mask, and removes it from the
+  // mask. The parts are thus visited in the same order as a linear scan.
+  static inline uint8_t Next(PartMask* mask) {
+    uint8_t index = __builtin_ctz(*mask);
+    *mask &= *mask - 1;
+    return index;
+  }
+  
+ private:
+  PartMask channel_[16];
+  PartMask note_[128];
+  PartMask velocity_[128];
+  
+  DISALLOW_COPY_AND_ASSIGN(RoutingTable);
+};
+
+}  // namespace yarns
+
+#endif // YARNS_ROUTING_TABLE_H_
@@ -0,0 +1,219 @@
+// Copyright 2013 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+//
+// -----------------------------------------------------------------------------
+//
+// Offline rendering of the sequencers, arpeggiators and song of a multi.
+
+#include "yarns/sequence_compiler.h"
+
+#include "yarns/midi_handler.h"
+#include "yarns/multi.h"
+
+namespace yarns {
+
+void SequenceCompiler::Init(MidiEvent* events, size_t capacity) {
+  events_ = events;
+  capacity_ = capacity;
+  num_events_ = 0;
+  timestamp_ = 0;
+  overflow_ = false;
+  event_.size = 0;
+  expected_size_ = 0;
+  
+  // Whatever the multi sent before does not belong to the timeline.
+  midi_handler.mutable_output_buffer()->Flush();
+  midi_handler.mutable_high_priority_output_buffer()->Flush();
+}
+
+bool SequenceCompiler::Compile(Multi* multi, size_t size) {
+  MidiHandler::MidiBuffer* output = midi_handler.mutable_output_buffer();
+  while (size--) {
+    multi->RenderClock();
+    while (output->readable()) {
+      Parse(output->ImmediateRead());
+    }
+    ++timestamp_;
+  }
+  // Clock, start and stop messages are not part of the timeline.
+  midi_handler.mutable_high_priority_output_buffer()->Flush();
+  return !overflow_;
+}
+
+void SequenceCompiler::Parse(uint8_t byte) {
+  if (byte >= 0xf8) {
+    return;
+  }
+  if (byte & 0x80) {
+    event_.timestamp = timestamp_;
+    event_.size = 1;
+    event_.data[0] = byte;
+    uint8_t hi = byte & 0xf0;
+    expected_size_ = (hi == 0xc0 || hi == 0xd0) ? 2 : (hi == 0xf0 ? 0 : 3);
+    return;
+  }
+  if (event_.size >= expected_size_) {
+    // Stray data byte, or system exclusive message.
+    return;
+  }
+  event_.data[event_.size++] = byte;
+  if (event_.size == expected_size_) {
+    if (num_events_ < capacity_) {
+      events_[num_events_++] = event_;
+    } else {
+      overflow_ = true;
+    }
+    // Running status.
+    event_.size = 1;
+  }
+}
+
+void SequencePlayer::Init(
+    const MidiEvent* events,
+    size_t num_events,
+    uint32_t loop_length) {
+  events_ = events;
+  num_events_ = num_events;
+  loop_length_ = loop_length;
+  if (loop_length_) {
+    // The events past the end of the loop are never played.
+    num_events_ = LowerBound(loop_length_);
+  }
+  num_active_notes_ = 0;
+  last_timestamp_ = 0;
+  Start(0);
+}
+
+void SequencePlayer::Start(uint32_t timestamp) {
+  start_ = timestamp;
+  origin_ = timestamp;
+  cursor_ = 0;
+  
+  // Release the notes held at the previous position as soon as possible.
+  releasing_ = true;
+  release_time_ = last_timestamp_;
+}
+
+void SequencePlayer::Seek(uint32_t position) {
+  releasing_ = true;
+  release_time_ = last_timestamp_;
+  origin_ = start_;
+  if (loop_length_) {
+    origin_ += position / loop_length_ * loop_length_;
+    position %= loop_length_;
+  }
+  cursor_ = LowerBound(position);
+}
+
+size_t SequencePlayer::LowerBound(uint32_t position) const {
+  size_t first = 0;
+  size_t last = num_events_;
+  while (first < last) {
+    size_t middle = (first + last) >> 1;
+    if (events_[middle].timestamp < position) {
+      first = middle + 1;
+    } else {
+      last = middle;
+    }
+  }
+  return first;
+}
+
+void SequencePlayer::Track(const MidiEvent& event) {
+  const uint8_t status = event.data[0] & 0xf0;
+  const uint8_t channel = event.data[0] & 0x0f;
+  if (status != 0x80 && status != 0x90) {
+    return;
+  }
+  const uint8_t note = event.data[1];
+  for (size_t i = 0; i < num_active_notes_; ++i) {
+    if (active_note_[i].channel == channel && active_note_[i].note == note) {
+      if (status == 0x80 || !event.data[2]) {
+        active_note_[i] = active_note_[--num_active_notes_];
+      }
+      return;
+    }
+  }
+  if (status == 0x90 && event.data[2] && \
+      num_active_notes_ < kMaxSequencePlayerNotes) {
+    active_note_[num_active_notes_].channel = channel;
+    active_note_[num_active_notes_].note = note;
+    ++num_active_notes_;
+  }
+}
+
+bool SequencePlayer::Release(MidiEventQueue* queue, uint32_t end) {
+  while (num_active_notes_) {
+    const ActiveNote& n = active_note_[num_active_notes_ - 1];
+    MidiEvent event;
+    event.timestamp = release_time_;
+    event.size = 3;
+    event.data[0] = 0x80 | n.channel;
+    event.data[1] = n.note;
+    event.data[2] = 0;
+    if (static_cast<int32_t>(event.timestamp - end) >= 0 || \
+        !queue->Push(event)) {
+      return false;
+    }
+    last_timestamp_ = event.timestamp;
+    --num_active_notes_;
+  }
+  releasing_ = false;
+  return true;
+}
+
+void SequencePlayer::Play(MidiEventQueue* queue, uint32_t end) {
+  if (releasing_ && !Release(queue, end)) {
+    return;
+  }
+  while (num_events_) {
+    if (cursor_ >= num_events_) {
+      // Close the notes still held at the end of the loop - or right after
+      // the last event of the timeline.
+      if (!releasing_) {
+        releasing_ = true;
+        release_time_ = origin_ + (loop_length_
+            ? loop_length_
+            : events_[num_events_ - 1].timestamp);
+      }
+      if (!Release(queue, end) || !loop_length_) {
+        return;
+      }
+      cursor_ = 0;
+      origin_ += loop_length_;
+    }
+    MidiEvent event = events_[cursor_];
+    event.timestamp += origin_;
+    if (static_cast<int32_t>(event.timestamp - end) >= 0 || \
+        !queue->Push(event)) {
+      return;
+    }
+    last_timestamp_ = event.timestamp;
+    Track(event);
+    ++cursor_;
+  }
+}
+
+}  // namespace yarns
@@ -0,0 +1,152 @@
+// Copyright 2013 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+//
+// -----------------------------------------------------------------------------
+//
+// Offline rendering of the sequencers, arpeggiators and song of a multi into a
+// flat timeline of timestamped MIDI events, and playback of such a timeline.
+//
+// The compiler runs the clock of the multi faster than real time, without
+// refreshing or rendering the voices, and records the MIDI messages the module
+// would send on its output - so only the parts in MIDI_OUT_MODE_GENERATED_EVENTS
+// are captured. The timestamps are those at which Multi::Render would have sent
+// the same messages.
+
+#ifndef YARNS_SEQUENCE_COMPILER_H_
+#define YARNS_SEQUENCE_COMPILER_H_
+
+#include "stmlib/stmlib.h"
+
+#include "yarns/midi_event_queue.h"
+
+namespace yarns {
+
+class Multi;
+
+class SequenceCompiler {
+ public:
+  SequenceCompiler() { }
+  ~SequenceCompiler() { }
+
+  // The events are written to events, up to capacity of them, timestamped in
+  // samples from the beginning of the compilation.
+  void Init(MidiEvent* events, size_t capacity);
+
+  // Runs the internal clock of the multi for size samples, appending the
+  // generated events to the timeline. The multi must have been started before.
+  // Returns false once the timeline is full.
+  bool Compile(Multi* multi, size_t size);
+
+  inline const MidiEvent* events() const { return events_; }
+  inline size_t num_events() const { return num_events_; }
+  inline uint32_t timestamp() const { return timestamp_; }
+  inline bool overflow() const { return overflow_; }
+
+ private:
+  void Parse(uint8_t byte);
+
+  MidiEvent* events_;
+  size_t capacity_;
+  size_t num_events_;
+  uint32_t timestamp_;
+  bool overflow_;
+
+  // Message being parsed from the output of the MIDI handler.
+  MidiEvent event_;
+  uint8_t expected_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(SequenceCompiler);
+};
+
+const size_t kMaxSequencePlayerNotes = 32;
+
+// Cursor into a compiled timeline, feeding its events to the queue read by
+// Multi::Render. The timeline is looped every loop_length samples, unless
+// loop_length is 0. The notes still held at the end of the loop or timeline,
+// or when the cursor is moved, are released by the player.
+//
+// The events are played into the inputs of the multi: the parts receiving
+// them must have their sequencer and arpeggiator disabled, otherwise the
+// compiled notes would be sequenced or arpeggiated a second time.
+class SequencePlayer {
+ public:
+  SequencePlayer() { }
+  ~SequencePlayer() { }
+
+  void Init(
+      const MidiEvent* events,
+      size_t num_events,
+      uint32_t loop_length);
+
+  // Plays the beginning of the timeline at sample time timestamp.
+  void Start(uint32_t timestamp);
+
+  // Moves the cursor to the first event at or after position (in samples from
+  // the beginning of the timeline), without playing the events before it.
+  void Seek(uint32_t position);
+
+  // Pushes to the queue the events due before sample time end. Stops early
+  // when the queue is full: the remaining events are pushed by the next call.
+  void Play(MidiEventQueue* queue, uint32_t end);
+
+  inline bool done() const {
+    return !loop_length_ && cursor_ >= num_events_ && !num_active_notes_;
+  }
+
+ private:
+  struct ActiveNote {
+    uint8_t channel;
+    uint8_t note;
+  };
+  
+  // Index of the first event at or after position.
+  size_t LowerBound(uint32_t position) const;
+  
+  void Track(const MidiEvent& event);
+  
+  // Sends a note off, at release_time_, for each note still held. Returns
+  // false when it had to stop early.
+  bool Release(MidiEventQueue* queue, uint32_t end);
+
+  const MidiEvent* events_;
+  size_t num_events_;
+  uint32_t loop_length_;
+
+  size_t cursor_;
+  uint32_t start_;
+  uint32_t origin_;  // Sample time of the beginning of the current loop.
+  
+  ActiveNote active_note_[kMaxSequencePlayerNotes];
+  size_t num_active_notes_;
+  bool releasing_;
+  uint32_t release_time_;
+  uint32_t last_timestamp_;  // Sample time of the last event played.
+
+  DISALLOW_COPY_AND_ASSIGN(SequencePlayer);
+};
+
+}  // namespace yarns
+
+#endif // YARNS_SEQUENCE_COMPILER_H_
@@ -0,0 +1,155 @@
+// Copyright 2013 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "yarns/midi_handler.h"
+#include "yarns/multi.h"
+#include "yarns/voice_allocator.h"
+
+using namespace yarns;
+using namespace std;
+using namespace stmlib;
+
+const size_t kDuration = 48000;
+
+MidiEventQueue queue;
+
+// Four monophonic parts with different portamento and oscillator settings,
+// played by a random stream of notes and pitch bends.
+void InitQuadMono() {
+  multi.Init(true);
+  midi_handler.Init();
+  queue.Init();
+  multi.Set(MULTI_LAYOUT, LAYOUT_QUAD_MONO);
+  for (uint8_t i = 0; i < kNumCVOutputs; ++i) {
+    Part* part = multi.mutable_part(i);
+    part->Set(PART_MIDI_CHANNEL, i);
+    part->Set(PART_VOICING_PORTAMENTO, 30 * i);
+    part->Set(PART_VOICING_VIBRATO_RANGE, 3);
+    part->Set(PART_VOICING_AUDIO_MODE, i == 3 ? 0 : 1 + i);
+  }
+  
+  srand(1);
+  uint32_t timestamp = 0;
+  for (int i = 0; i < 200; ++i) {
+    MidiEvent e;
+    timestamp += rand() % 400;
+    e.timestamp = timestamp;
+    e.size = 3;
+    int type = rand() % 4;
+    e.data[0] = (type < 2 ? 0x90 : (type == 2 ? 0x80 : 0xe0)) | (rand() % 4);
+    e.data[1] = type == 3 ? 1 : 36 + rand() % 48;
+    e.data[2] = rand() % 128;
+    queue.Push(e);
+  }
+}
+
+void TestRenderVoices() {
+  // Reference: the per-sample renderer, with interleaved outputs.
+  InitQuadMono();
+  vector<uint16_t> cv(kDuration * kNumCVOutputs);
+  vector<bool> gate(kDuration * kNumCVOutputs);
+  for (size_t t = 0; t < kDuration; t += 64) {
+    bool g[kNumCVOutputs * 64];
+    multi.Render(&queue, t, &cv[t * kNumCVOutputs], g, 64);
+    copy(&g[0], &g[kNumCVOutputs * 64], gate.begin() + t * kNumCVOutputs);
+  }
+  
+  // Whatever the block size, the block renderer must give the same note CV
+  // and gates as the reference, and always the same audio.
+  const size_t block_sizes[] = { 1, 7, 64, 1000 };
+  vector<uint16_t> reference_audio;
+  for (size_t b = 0; b < 4; ++b) {
+    const size_t size = block_sizes[b];
+    InitQuadMono();
+    vector<uint16_t> note_cv(kNumVoices * size);
+    vector<uint16_t> audio(kNumVoices * size);
+    vector<uint16_t> all_audio;
+    bool* g = new bool[kNumVoices * size];
+    int cv_errors = 0;
+    int gate_errors = 0;
+    size_t t = 0;
+    for (; t + size <= kDuration; t += size) {
+      multi.RenderVoices(&queue, t, &note_cv[0], g, &audio[0], size);
+      for (size_t i = 0; i < size; ++i) {
+        for (size_t v = 0; v < kNumCVOutputs; ++v) {
+          const size_t j = (t + i) * kNumCVOutputs + v;
+          // The first 3 voices output audio instead of their note CV.
+          cv_errors += v == 3 && note_cv[v * size + i] != cv[j];
+          gate_errors += g[v * size + i] != gate[j];
+          all_audio.push_back(audio[v * size + i]);
+        }
+      }
+    }
+    delete[] g;
+    
+    int audio_errors = 0;
+    if (b == 0) {
+      reference_audio = all_audio;
+    } else {
+      for (size_t i = 0; i < all_audio.size(); ++i) {
+        audio_errors += all_audio[i] != reference_audio[i];
+      }
+    }
+    printf("Block size %4zu: %d CV errors, %d gate errors, %d audio errors\n",
+           size, cv_errors, gate_errors, audio_errors);
+  }
+}
+
+void TestVoiceAllocator() {
+  yarns::VoiceAllocator<8> allocator;
+  allocator.Init();
+  allocator.set_size(4);
+  
+  // After all notes off, a note struck again gets its previous voice.
+  uint8_t voice = allocator.NoteOn(60, VOICE_STEALING_MODE_LRU);
+  allocator.NoteOn(64, VOICE_STEALING_MODE_LRU);
+  allocator.ClearNotes();
+  printf("Re-strike after all notes off: voice %d (expected %d)\n",
+         allocator.NoteOn(60, VOICE_STEALING_MODE_LRU), voice);
+  
+  // Changing the size keeps the order in which the voices were used: the
+  // least recently used voice is still picked first.
+  allocator.Clear();
+  allocator.NoteOn(60, VOICE_STEALING_MODE_LRU);  // voice 0
+  allocator.NoteOn(62, VOICE_STEALING_MODE_LRU);  // voice 1
+  allocator.NoteOff(62);
+  allocator.NoteOff(60);
+  allocator.set_size(6);
+  allocator.set_size(4);
+  uint8_t voices[4];
+  for (uint8_t i = 0; i < 4; ++i) {
+    voices[i] = allocator.NoteOn(40 + i, VOICE_STEALING_MODE_LRU);
+  }
+  printf("Order kept after resizing: voices %d %d %d %d (expected 2 3 1 0)\n",
+         voices[0], voices[1], voices[2], voices[3]);
+}
+
+int main(void) {
+  TestVoiceAllocator();
+  TestRenderVoices();
+}
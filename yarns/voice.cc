@@ -168,6 +168,39 @@ void Voice::Refresh() {
   }
 }
 
+void Voice::Render(
+    uint8_t refresh_counter,
+    uint16_t* note_cv,
+    bool* gate,
+    uint16_t* audio,
+    size_t size) {
+  while (size) {
+    if (--refresh_counter == 0) {
+      Refresh();
+      refresh_counter = kRefreshPeriod;
+      oscillator_.Glide(note_, kRefreshPeriod);
+    }
+    
+    // The state of the voice stays the same until the next refresh: render
+    // the samples up to it in one go.
+    size_t n = std::min(size, static_cast<size_t>(refresh_counter));
+    if (note_cv) {
+      std::fill(&note_cv[0], &note_cv[n], note_dac_code_);
+      note_cv += n;
+    }
+    if (gate) {
+      std::fill(&gate[0], &gate[n], this->gate());
+      gate += n;
+    }
+    if (audio) {
+      oscillator_.Render(audio_mode_, gate_, audio, n);
+      audio += n;
+    }
+    refresh_counter -= n - 1;
+    size -= n;
+  }
+}
+
 void Voice::NoteOn(
     int16_t note,
     uint8_t velocity,
@@ -258,6 +291,9 @@ static const uint16_t kPitchTableStart = 116 * 128;
 void Oscillator::Init(int32_t scale, int32_t offset) {
   audio_buffer_.Init();
   phase_ = 0;
+  phase_increment_ = target_phase_increment_ = 0;
+  phase_increment_delta_ = 0;
+  glide_counter_ = 0;
   next_sample_ = 0;
   high_ = false;
   scale_ = scale;
@@ -287,34 +323,39 @@ uint32_t Oscillator::ComputePhaseIncrement(int16_t midi_pitch) {
   return phase_increment;
 }
 
-void Oscillator::RenderSilence() {
-  size_t size = kAudioBlockSize;
-  while (size--) {
-    audio_buffer_.Overwrite(offset_);
-  }
+void Oscillator::RenderSilence(uint16_t* out, size_t size) {
+  std::fill(&out[0], &out[size], static_cast<uint16_t>(offset_));
 }
 
-void Oscillator::RenderSine(uint32_t phase_increment) {
-  size_t size = kAudioBlockSize;
+void Oscillator::RenderSine(
+    uint32_t phase_increment,
+    int32_t phase_increment_delta,
+    uint16_t* out,
+    size_t size) {
+  uint32_t phase = phase_;
   while (size--) {
-    phase_ += phase_increment;
-    int32_t sample = Interpolate1022(wav_sine, phase_);
-    audio_buffer_.Overwrite(offset_ - (scale_ * sample >> 16));
+    phase += phase_increment;
+    phase_increment += phase_increment_delta;
+    int32_t sample = Interpolate1022(wav_sine, phase);
+    *out++ = offset_ - (scale_ * sample >> 16);
   }
+  phase_ = phase;
 }
 
-void Oscillator::RenderNoise() {
-  size_t size = kAudioBlockSize;
+void Oscillator::RenderNoise(uint16_t* out, size_t size) {
   while (size--) {
     int16_t sample = Random::GetSample();
-    audio_buffer_.Overwrite(offset_ - (scale_ * sample >> 16));
+    *out++ = offset_ - (scale_ * sample >> 16);
   }
 }
 
-void Oscillator::RenderSaw(uint32_t phase_increment) {
+void Oscillator::RenderSaw(
+    uint32_t phase_increment,
+    int32_t phase_increment_delta,
+    uint16_t* out,
+    size_t size) {
   uint32_t phase = phase_;
   int32_t next_sample = next_sample_;
-  size_t size = kAudioBlockSize;
 
   while (size--) {
     int32_t this_sample = next_sample;
@@ -325,9 +366,10 @@ void Oscillator::RenderSaw(uint32_t phase_increment) {
       this_sample -= ThisBlepSample(t);
       next_sample -= NextBlepSample(t);
     }
+    phase_increment += phase_increment_delta;
     next_sample += phase >> 17;
     this_sample = (this_sample - 16384) << 1;
-    audio_buffer_.Overwrite(offset_ - (scale_ * this_sample >> 16));
+    *out++ = offset_ - (scale_ * this_sample >> 16);
   }
   next_sample_ = next_sample;
   phase_ = phase;
@@ -335,13 +377,15 @@ void Oscillator::RenderSaw(uint32_t phase_increment) {
 
 void Oscillator::RenderSquare(
     uint32_t phase_increment,
+    int32_t phase_increment_delta,
     uint32_t pw,
-    bool integrate) {
+    bool integrate,
+    uint16_t* out,
+    size_t size) {
   uint32_t phase = phase_;
   int32_t next_sample = next_sample_;
   int32_t integrator_state = integrator_state_;
   int16_t integrator_coefficient = phase_increment >> 18;
-  size_t size = kAudioBlockSize;
 
   while (size--) {
     int32_t this_sample = next_sample;
@@ -362,50 +406,107 @@ void Oscillator::RenderSquare(
       next_sample -= NextBlepSample(t);
       high_ = false;
     }
+    phase_increment += phase_increment_delta;
     next_sample += phase < pw ? 0 : 32767;
     this_sample = (this_sample - 16384) << 1;
     if (integrate) {
       integrator_state += integrator_coefficient * (this_sample - integrator_state) >> 15;
       this_sample = integrator_state << 3;
     }
-    audio_buffer_.Overwrite(offset_ - (scale_ * this_sample >> 16));
+    *out++ = offset_ - (scale_ * this_sample >> 16);
   }
   integrator_state_ = integrator_state;
   next_sample_ = next_sample;
   phase_ = phase;
 }
 
-void Oscillator::Render(uint8_t mode, int16_t note, bool gate) {
-  if (mode == 0 || audio_buffer_.writable() < kAudioBlockSize) {
-    return;
-  }
-  
+void Oscillator::RenderWaveform(
+    uint8_t mode,
+    bool gate,
+    int32_t phase_increment_delta,
+    uint16_t* out,
+    size_t size) {
   if ((mode & 0x80) && !gate) {
-    RenderSilence();
+    RenderSilence(out, size);
     return;
   }
   
-  uint32_t phase_increment = ComputePhaseIncrement(note);
+  uint32_t phase_increment = phase_increment_;
   switch ((mode & 0x0f) - 1) {
     case 0:
-      RenderSaw(phase_increment);
+      RenderSaw(phase_increment, phase_increment_delta, out, size);
       break;
     case 1:
-      RenderSquare(phase_increment, 0x40000000, false);
+      RenderSquare(
+          phase_increment, phase_increment_delta, 0x40000000, false, out, size);
       break;
     case 2:
-      RenderSquare(phase_increment, 0x80000000, false);
+      RenderSquare(
+          phase_increment, phase_increment_delta, 0x80000000, false, out, size);
       break;
     case 3:
-      RenderSquare(phase_increment, 0x80000000, true);
+      RenderSquare(
+          phase_increment, phase_increment_delta, 0x80000000, true, out, size);
       break;
     case 4:
-      RenderSine(phase_increment);
+      RenderSine(phase_increment, phase_increment_delta, out, size);
       break;
     default:
-      RenderNoise();
+      RenderNoise(out, size);
       break;
   }
 }
 
+void Oscillator::Render(
+    uint8_t mode,
+    int16_t note,
+    bool gate,
+    size_t size) {
+  if (mode == 0 || audio_buffer_.writable() < size) {
+    return;
+  }
+  
+  phase_increment_ = target_phase_increment_ = ComputePhaseIncrement(note);
+  phase_increment_delta_ = 0;
+  glide_counter_ = 0;
+  uint16_t block[kAudioBlockSize];
+  while (size) {
+    size_t n = std::min(size, kAudioBlockSize);
+    RenderWaveform(mode, gate, 0, block, n);
+    for (size_t i = 0; i < n; ++i) {
+      audio_buffer_.Overwrite(block[i]);
+    }
+    size -= n;
+  }
+}
+
+void Oscillator::Glide(int16_t note, size_t size) {
+  target_phase_increment_ = ComputePhaseIncrement(note);
+  phase_increment_delta_ = static_cast<int32_t>(
+      target_phase_increment_ - phase_increment_) / static_cast<int32_t>(size);
+  glide_counter_ = size;
+}
+
+void Oscillator::Render(uint8_t mode, bool gate, uint16_t* out, size_t size) {
+  while (size) {
+    // Render up to the end of the glide, then the rest at the target pitch.
+    size_t n = glide_counter_ ? std::min(size, glide_counter_) : size;
+    if (mode == 0) {
+      RenderSilence(out, n);
+    } else {
+      RenderWaveform(mode, gate, phase_increment_delta_, out, n);
+    }
+    if (glide_counter_) {
+      phase_increment_ += phase_increment_delta_ * static_cast<int32_t>(n);
+      glide_counter_ -= n;
+      if (!glide_counter_) {
+        phase_increment_ = target_phase_increment_;
+        phase_increment_delta_ = 0;
+      }
+    }
+    out += n;
+    size -= n;
+  }
+}
+
 }  // namespace yarns
\ No newline at end of file
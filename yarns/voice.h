@@ -37,6 +37,9 @@ namespace yarns {
 const uint16_t kNumOctaves = 11;
 const size_t kAudioBlockSize = 64;
 
+// The control rate state is refreshed at 8kHz: every 6 samples at 48kHz.
+const uint8_t kRefreshPeriod = 6;
+
 enum TriggerShape {
   TRIGGER_SHAPE_SQUARE,
   TRIGGER_SHAPE_LINEAR,
@@ -59,7 +62,14 @@ class Oscillator {
   Oscillator() { }
   ~Oscillator() { }
   void Init(int32_t scale, int32_t offset);
-  void Render(uint8_t mode, int16_t note, bool gate);
+  void Render(uint8_t mode, int16_t note, bool gate, size_t size);
+  
+  // Host-side rendering, writing size samples to out rather than to the
+  // buffer. The pitch set by Glide is reached linearly, so that the control
+  // rate changes of pitch do not produce steps.
+  void Glide(int16_t note, size_t size);
+  void Render(uint8_t mode, bool gate, uint16_t* out, size_t size);
+  
   inline uint16_t ReadSample() {
     return audio_buffer_.ImmediateRead();
   }
@@ -67,11 +77,32 @@ class Oscillator {
  private:
   uint32_t ComputePhaseIncrement(int16_t pitch);
   
-  void RenderSilence();
-  void RenderNoise();
-  void RenderSine(uint32_t phase_increment);
-  void RenderSaw(uint32_t phase_increment);
-  void RenderSquare(uint32_t phase_increment, uint32_t pw, bool integrate);
+  void RenderWaveform(
+      uint8_t mode,
+      bool gate,
+      int32_t phase_increment_delta,
+      uint16_t* out,
+      size_t size);
+  
+  void RenderSilence(uint16_t* out, size_t size);
+  void RenderNoise(uint16_t* out, size_t size);
+  void RenderSine(
+      uint32_t phase_increment,
+      int32_t phase_increment_delta,
+      uint16_t* out,
+      size_t size);
+  void RenderSaw(
+      uint32_t phase_increment,
+      int32_t phase_increment_delta,
+      uint16_t* out,
+      size_t size);
+  void RenderSquare(
+      uint32_t phase_increment,
+      int32_t phase_increment_delta,
+      uint32_t pw,
+      bool integrate,
+      uint16_t* out,
+      size_t size);
 
   inline int32_t ThisBlepSample(uint32_t t) {
     if (t > 65535) {
@@ -91,6 +122,10 @@ class Oscillator {
   int32_t scale_;
   int32_t offset_;
   uint32_t phase_;
+  uint32_t phase_increment_;
+  uint32_t target_phase_increment_;
+  int32_t phase_increment_delta_;
+  size_t glide_counter_;
   int32_t next_sample_;
   int32_t integrator_state_;
   bool high_;
@@ -203,12 +238,28 @@ class Voice {
     return audio_mode_;
   }
   inline void RenderAudio() {
-    oscillator_.Render(audio_mode_, note_, gate_);
+    oscillator_.Render(audio_mode_, note_, gate_, kAudioBlockSize);
+  }
+  // Renders a shorter run of samples, used by the host to stop rendering at
+  // the exact sample at which an event changes the note or gate.
+  inline void RenderAudio(size_t size) {
+    oscillator_.Render(audio_mode_, note_, gate_, size);
   }
   inline uint16_t ReadSample() {
     return oscillator_.ReadSample();
   }
   
+  // Host-side block rendering of the note CV, gate and audio output of the
+  // voice (any of them can be NULL). The control rate state is refreshed on
+  // the samples at which refresh_counter, decremented on each sample, reaches
+  // zero, as in Multi::Render.
+  void Render(
+      uint8_t refresh_counter,
+      uint16_t* note_cv,
+      bool* gate,
+      uint16_t* audio,
+      size_t size);
+  
   void TapLfo(uint32_t target_phase) {
     uint32_t target_increment = target_phase - lfo_pll_previous_target_phase_;
     
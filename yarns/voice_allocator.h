@@ -0,0 +1,230 @@
+// Copyright 2013 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Polyphonic voice allocator.
+//
+// Same behaviour as stmlib::VoiceAllocator, but the voices are kept in two
+// lists (released and playing), each of them sorted from the least to the
+// most recently used voice. Choosing and touching a voice is thus done in
+// constant time rather than by scanning and shifting the whole LRU table;
+// only looking up the voice playing a note is linear in the number of voices.
+// As in stmlib::VoiceAllocator, the voices keep their note and the order in
+// which they were used when all notes are released, or when the size is
+// changed.
+
+#ifndef YARNS_VOICE_ALLOCATOR_H_
+#define YARNS_VOICE_ALLOCATOR_H_
+
+#include "stmlib/stmlib.h"
+
+#include "stmlib/algorithms/voice_allocator.h"
+
+namespace yarns {
+
+template<uint8_t capacity>
+class VoiceAllocator {
+ public:
+  VoiceAllocator() { }
+  ~VoiceAllocator() { }
+
+  void Init() {
+    size_ = 0;
+    Clear();
+  }
+
+  uint8_t NoteOn(uint8_t note, stmlib::VoiceStealingMode mode) {
+    if (size_ == 0) {
+      return kNone;
+    }
+
+    // First, check if there is a voice currently playing this note. In this
+    // case, this voice will be responsible for retriggering this note.
+    uint8_t voice = Find(note);
+
+    // Then, try to find the least recently touched, currently inactive voice.
+    if (voice == kNone) {
+      voice = released_list_.head;
+    }
+
+    // If all voices are active, steal the least (or most) recently played one.
+    if (voice == kNone) {
+      if (mode == stmlib::VOICE_STEALING_MODE_NONE) {
+        return kNone;
+      }
+      voice = mode == stmlib::VOICE_STEALING_MODE_MRU
+          ? playing_list_.tail
+          : playing_list_.head;
+    }
+
+    Remove(voice);
+    note_[voice] = note;
+    Append(&playing_list_, voice);
+    return voice;
+  }
+
+  uint8_t NoteOff(uint8_t note) {
+    uint8_t voice = Find(note);
+    if (voice != kNone) {
+      Remove(voice);
+      Append(&released_list_, voice);
+    }
+    return voice;
+  }
+
+  uint8_t Find(uint8_t note) const {
+    for (uint8_t i = 0; i < size_; ++i) {
+      if (note_[i] == note) {
+        return i;
+      }
+    }
+    return kNone;
+  }
+
+  void Clear() {
+    clock_ = 0;
+    for (uint8_t i = 0; i < capacity; ++i) {
+      note_[i] = kNone;
+      playing_[i] = false;
+      touched_[i] = clock_++;
+    }
+    Rebuild();
+  }
+
+  // Releases all the voices, keeping them in the order in which they were
+  // last touched. The voices keep their note, so that a note struck again is
+  // given the same voice.
+  void ClearNotes() {
+    uint8_t released = released_list_.head;
+    uint8_t playing = playing_list_.head;
+    released_list_.head = released_list_.tail = kNone;
+    playing_list_.head = playing_list_.tail = kNone;
+    while (released != kNone || playing != kNone) {
+      uint8_t voice;
+      if (playing == kNone || (released != kNone && \
+          static_cast<int32_t>(touched_[released] - touched_[playing]) < 0)) {
+        voice = released;
+        released = next_[released];
+      } else {
+        voice = playing;
+        playing = next_[playing];
+      }
+      Link(&released_list_, voice);
+    }
+    for (uint8_t i = size_; i < capacity; ++i) {
+      playing_[i] = false;
+    }
+  }
+
+  void set_size(uint8_t size) {
+    size_ = size < capacity ? size : capacity;
+    Rebuild();
+  }
+
+  uint8_t size() const { return size_; }
+
+ private:
+  enum {
+    kNone = 0xff
+  };
+
+  struct List {
+    uint8_t head;
+    uint8_t tail;
+  };
+
+  // Rebuilds the lists from the first size_ voices, sorted by the time at
+  // which they were last touched.
+  void Rebuild() {
+    uint8_t order[capacity];
+    for (uint8_t i = 0; i < size_; ++i) {
+      uint8_t j = i;
+      while (j > 0 && \
+          static_cast<int32_t>(touched_[order[j - 1]] - touched_[i]) > 0) {
+        order[j] = order[j - 1];
+        --j;
+      }
+      order[j] = i;
+    }
+    released_list_.head = released_list_.tail = kNone;
+    playing_list_.head = playing_list_.tail = kNone;
+    for (uint8_t i = 0; i < size_; ++i) {
+      uint8_t voice = order[i];
+      Link(playing_[voice] ? &playing_list_ : &released_list_, voice);
+    }
+  }
+
+  inline List* list_of(uint8_t voice) {
+    return playing_[voice] ? &playing_list_ : &released_list_;
+  }
+
+  void Append(List* list, uint8_t voice) {
+    touched_[voice] = clock_++;
+    Link(list, voice);
+  }
+
+  void Link(List* list, uint8_t voice) {
+    playing_[voice] = list == &playing_list_;
+    previous_[voice] = list->tail;
+    next_[voice] = kNone;
+    if (list->tail != kNone) {
+      next_[list->tail] = voice;
+    } else {
+      list->head = voice;
+    }
+    list->tail = voice;
+  }
+
+  void Remove(uint8_t voice) {
+    List* list = list_of(voice);
+    if (previous_[voice] != kNone) {
+      next_[previous_[voice]] = next_[voice];
+    } else {
+      list->head = next_[voice];
+    }
+    if (next_[voice] != kNone) {
+      previous_[next_[voice]] = previous_[voice];
+    } else {
+      list->tail = previous_[voice];
+    }
+  }
+
+  uint8_t note_[capacity];
+  uint8_t previous_[capacity];
+  uint8_t next_[capacity];
+  bool playing_[capacity];
+  uint32_t touched_[capacity];
+
+  List released_list_;
+  List playing_list_;
+  uint32_t clock_;
+  uint8_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(VoiceAllocator);
+};
+
+}  // namespace yarns
+
+#endif // YARNS_VOICE_ALLOCATOR_H_